@@ -1,47 +1,373 @@
 #pragma once
 
-#include <iostream>
-#include <vector>
-#include <functional>
-#include <source_location>
-#include <string_view>
-#include <tuple>
-#include <concepts>
+// Registration, expect() and mocks: everything a test translation unit
+// needs. The runner, reporters and flag parsing are compiled once into the
+// ModernTest_Runner library; ModernTestRunner.hpp declares them for tools
+// and white-box tests.
 #include <algorithm>
-#include <ranges>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
 #include <cmath>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <source_location>
+#include <span>
+#include <streambuf>
 #include <string>
-#include <chrono>
-#include <fstream>
-#include <sstream>
-#include <regex>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace mt {
 
-// --- 1. GLOBALS & COLORS ---
-inline bool use_colors = true;
-inline constexpr std::string_view default_suite_name = "ModernTest";
+// --- 1. CONTEXT ---
+// A failed assertion (or unhandled exception) inside a test. Repeated
+// failures of one assertion are folded into one entry: `message` is the
+// first, `recent` keeps the latest few after it.
+struct Failure {
+    std::string file;
+    int line = 0;
+    std::string message;
+    std::size_t hits = 1;
+    std::vector<std::string> recent;
+};
+
+inline constexpr std::size_t recent_failure_messages = 3;
+
+// What identifies one assertion for folding, besides file and line: the
+// column and the address expect() returns to. GCC reports the TEST macro's
+// line and column for every assertion in its body, so only the address
+// tells two assertions on "one line" apart; it is null where the compiler
+// cannot provide it, and for failures the runner records itself.
+struct FailureSite {
+    const void* address = nullptr;
+    std::uint_least32_t column = 0;
+
+    bool operator==(const FailureSite&) const = default;
+};
+
+// Failures a test records, repeats included, before further ones are only
+// counted (--mt_max_failures_per_test / MT_MAX_FAILURES_PER_TEST); 0: no cap.
+inline std::size_t max_failures_per_test = 100;
+
+// "file:line: message", plus the repeat count and latest message
+inline std::string describe(const Failure& f) {
+    std::string out = f.file + ":" + std::to_string(f.line) + ": " + f.message;
+    if (f.hits > 1) out += " (failed " + std::to_string(f.hits) + " times" + (f.recent.empty() ? "" : "; last: " + f.recent.back()) + ")";
+    return out;
+}
+
+struct TestResult;
+
+// Per-test state. Every running test owns one; assertions reach it through a
+// thread-local pointer so tests can run concurrently on worker threads.
+// The failures double as the test's event buffer, handed to the reporters
+// in full once the test has finished; while the runner streams events,
+// each one is also passed on as it is recorded.
+struct TestContext {
+    bool failed = false;
+    std::string file;
+    std::vector<Failure> failures;
+    std::vector<FailureSite> sites; // sites[i] recorded failures[i]
+    std::size_t recorded = 0;   // failures recorded, repeats included
+    std::size_t suppressed = 0; // failures past max_failures_per_test
+    const TestResult* live = nullptr; // the result live failure events name
+};
+
+namespace detail {
+inline thread_local TestContext* active_context = nullptr;
+
+// Installed by the runner for the duration of a run; without it recording a
+// failure costs one extra load.
+inline std::atomic<void (*)(const TestResult& test, const Failure& failure)> failure_sink{nullptr};
+}
+
+// Context of the test running on this thread. Assertions made outside of a
+// test (e.g. from a helper thread that never bound one) land in a
+// thread-local scratch context instead of racing on shared state.
+inline TestContext& current_test() {
+    static thread_local TestContext fallback;
+    return detail::active_context ? *detail::active_context : fallback;
+}
+
+// Binds a context to the calling thread for the lifetime of the scope.
+struct ContextScope {
+    TestContext* previous;
+    explicit ContextScope(TestContext& ctx) : previous(detail::active_context) { detail::active_context = &ctx; }
+    ~ContextScope() { detail::active_context = previous; }
+    ContextScope(const ContextScope&) = delete;
+    ContextScope& operator=(const ContextScope&) = delete;
+};
+
+// Set once a run is being cut short (--mt_fail_fast). Long-running tests
+// can poll cancellation_requested() or wait on cancellation_token()
+// (declared in ModernTestRunner.hpp) to return early; tests that have not
+// started yet are reported as skipped.
+namespace detail {
+inline std::atomic<bool> cancel_flag{false};
+}
+
+inline bool cancellation_requested() { return detail::cancel_flag.load(std::memory_order_relaxed); }
+
+// Defined in the ModernTest_Runner library.
+void request_cancellation();
+
+namespace detail {
+// A mutex on std::atomic wait/notify, so this header needs neither <mutex>
+// nor <condition_variable>. A contended lock() sleeps until the holder
+// unlocks, as with std::mutex.
+class Lock {
+public:
+    void lock() noexcept {
+        while (held_.exchange(true, std::memory_order_acquire)) held_.wait(true, std::memory_order_relaxed);
+    }
+    void unlock() noexcept {
+        held_.store(false, std::memory_order_release);
+        held_.notify_one();
+    }
+
+private:
+    std::atomic<bool> held_{false};
+};
+
+class LockGuard {
+public:
+    explicit LockGuard(Lock& lock) : lock_(lock) { lock_.lock(); }
+    ~LockGuard() { lock_.unlock(); }
+    LockGuard(const LockGuard&) = delete;
+    LockGuard& operator=(const LockGuard&) = delete;
+
+private:
+    Lock& lock_;
+};
+
+// Identifies the calling thread without <thread>: the address of a
+// thread-local object is unique among live threads.
+inline const void* thread_tag() {
+    static thread_local const char tag = 0;
+    return &tag;
+}
+
+// Blocks the calling thread; defined in the ModernTest_Runner library.
+void block_until(std::chrono::steady_clock::time_point when);
+
+// The <ranges> concepts this header uses, built from the range access
+// objects and iterator concepts of the much lighter <iterator>.
+template <typename R>
+using iterator_t = decltype(std::ranges::begin(std::declval<R&>()));
+template <typename R>
+using range_reference_t = std::iter_reference_t<iterator_t<R>>;
+template <typename R>
+concept range = requires(R& r) {
+    std::ranges::begin(r);
+    std::ranges::end(r);
+};
+template <typename R>
+concept sized_range = range<R> && requires(R& r) { std::ranges::size(r); };
+template <typename R>
+concept random_access_range = range<R> && std::random_access_iterator<iterator_t<R>>;
+template <typename R>
+concept contiguous_range = random_access_range<R> && std::contiguous_iterator<iterator_t<R>>;
+
+// An std::ostream that appends to a string, for building failure messages
+// with the operands' operator<< without pulling in <sstream>.
+class StringBuffer : public std::streambuf {
+public:
+    std::string text;
 
-inline std::string GREEN() { return use_colors ? "\033[32m" : ""; }
-inline std::string RED()   { return use_colors ? "\033[31m" : ""; }
-inline std::string YELLOW(){ return use_colors ? "\033[33m" : ""; }
-inline std::string GRAY()  { return use_colors ? "\033[90m" : ""; }
-inline std::string BOLD()  { return use_colors ? "\033[1m" : ""; }
-inline std::string RESET() { return use_colors ? "\033[0m" : ""; }
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) text.push_back(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        text.append(s, static_cast<std::size_t>(n));
+        return n;
+    }
+};
 
-inline bool current_test_failed = false;
-inline std::string current_test_file;
-inline std::vector<std::string> failure_messages;
+class MessageStream : private StringBuffer, public std::ostream {
+public:
+    MessageStream() : std::ostream(static_cast<StringBuffer*>(this)) {}
+    const std::string& str() const { return text; }
+};
+} // namespace detail
+
+// Timeline export (--mt_trace). The runner library installs the sinks while
+// a trace is being recorded; without them spans and counters cost one load.
+namespace detail {
+using TraceClock = std::chrono::high_resolution_clock;
+
+struct TraceSinks {
+    void (*span)(std::string_view name, std::string_view category, TraceClock::time_point start,
+                 TraceClock::time_point end);
+    void (*counter)(std::string_view name, double value);
+};
+
+inline std::atomic<const TraceSinks*> trace_sinks{nullptr};
+} // namespace detail
+
+// Times the enclosing block as a span on the calling thread's track:
+//   { mt::trace_scope decode("decode frame"); decode(frame); }
+class trace_scope {
+public:
+    explicit trace_scope(std::string_view name, std::string_view category = "user") {
+        if (!detail::trace_sinks.load(std::memory_order_relaxed)) return;
+        name_ = name;
+        category_ = category;
+        start_ = detail::TraceClock::now();
+        armed_ = true;
+    }
+    ~trace_scope() {
+        if (!armed_) return;
+        if (const auto* sinks = detail::trace_sinks.load(std::memory_order_acquire)) {
+            sinks->span(name_, category_, start_, detail::TraceClock::now());
+        }
+    }
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    std::string name_;
+    std::string category_;
+    detail::TraceClock::time_point start_{};
+    bool armed_ = false;
+};
+
+// Records a reading of `name` (queue depth, cache size, ...) as a counter
+// track of the trace.
+inline void trace_counter(std::string_view name, double value) {
+    if (const auto* sinks = detail::trace_sinks.load(std::memory_order_acquire)) sinks->counter(name, value);
+}
 
 // --- 2. REGISTRY ---
 enum class TestStatus { NORMAL, SKIP, ONLY };
+enum class TestKind { TEST, BENCH, ASYNC };
+
+class BenchState;
+template <typename T>
+class task;
+namespace detail {
+class FixtureBase;
+}
 
+// A registry node. Nodes live inside the static Registrar objects the TEST
+// macros create and are chained into an intrusive list, so registering a
+// test allocates nothing. The body is reached through a type-erased
+// function pointer and the callable stored next to the node (ASYNC bodies
+// hand back the mt::task the runner drives to completion). TEST_CASES
+// nodes share one body and carry their element index in case_number; their
+// "name/<case>" display name is only built when a report needs it.
 struct TestCase {
+    static constexpr std::size_t no_case = static_cast<std::size_t>(-1);
+
     std::string_view name;
-    std::function<void()> func;
     TestStatus status = TestStatus::NORMAL;
-    std::string file;
+    const char* file = "";
     int line = 0;
+    std::size_t index = 0; // registration order
+    TestKind kind = TestKind::TEST;
+    void* target = nullptr;
+    void (*invoke)(void* target, std::size_t case_number) = nullptr;
+    void (*invoke_bench)(void* target, BenchState& state) = nullptr;
+    task<void> (*invoke_async)(void* target, std::size_t case_number) = nullptr;
+    std::chrono::milliseconds time_limit{0}; // 0: --mt_timeout applies
+    std::size_t case_number = no_case;
+    std::span<detail::FixtureBase* const> fixtures; // declared with mt::uses
+    // Set on a TEST_CASES placeholder: returns one node per element, copied
+    // from the placeholder. See TestRegistry::expand_cases.
+    std::span<TestCase> (*expand)(void* target, const TestCase& placeholder) = nullptr;
+    TestCase* next = nullptr;
+
+    void func() const { invoke(target, case_number); }
+    void bench(BenchState& state) const { invoke_bench(target, state); }
+    task<void> run_async() const;
+    bool parameterized() const { return case_number != no_case; }
+    std::string display_name() const;
+};
+
+namespace detail {
+// The "/<case>" suffix of a TEST_CASES entry, formatted without allocating
+// so filtering and listing don't have to materialize full names.
+struct CaseSuffix {
+    char buf[24];
+    std::size_t len = 0;
+
+    explicit CaseSuffix(const TestCase& test) {
+        if (!test.parameterized()) return;
+        buf[0] = '/';
+        len = static_cast<std::size_t>(std::to_chars(buf + 1, buf + sizeof(buf), test.case_number).ptr - buf);
+    }
+    std::string_view view() const { return {buf, len}; }
+};
+} // namespace detail
+
+inline std::string TestCase::display_name() const {
+    detail::CaseSuffix suffix(*this);
+    std::string out;
+    out.reserve(name.size() + suffix.len);
+    out.append(name).append(suffix.view());
+    return out;
+}
+
+struct BenchComparison {
+    double change_pct = 0.0; // median, relative to the baseline
+    double p_value = 1.0;
+    bool regressed = false;
+};
+
+// Hardware counter readings (--mt_perf_counters, Linux perf_event). A
+// counter the CPU, kernel or container does not provide stays empty.
+struct PerfCounters {
+    std::optional<double> cycles;
+    std::optional<double> instructions;
+    std::optional<double> l1d_misses;
+    std::optional<double> llc_misses;
+    std::optional<double> branch_misses;
+
+    std::optional<double> ipc() const {
+        if (!cycles || !instructions || *cycles <= 0.0) return std::nullopt;
+        return *instructions / *cycles;
+    }
+};
+
+struct BenchResult {
+    std::uint64_t iterations = 0;      // per repetition
+    std::vector<double> samples_ns;    // ns per iteration, one per repetition
+    double mean_ns = 0.0;
+    double median_ns = 0.0;
+    double stddev_ns = 0.0;
+    double min_ns = 0.0;
+    double items_per_second = 0.0;
+    double bytes_per_second = 0.0;
+    std::optional<BenchComparison> comparison; // against --mt_bench_compare
+    std::optional<PerfCounters> counters;      // per iteration, timed regions only
+};
+
+// Per-test resource usage, recorded with --mt_instrument.
+struct ResourceUsage {
+    double user_cpu_ms = 0.0;
+    double system_cpu_ms = 0.0;
+    std::uint64_t allocations = 0;
+    std::uint64_t allocated_bytes = 0;
+    std::uint64_t peak_rss_delta_kb = 0;
+    std::optional<PerfCounters> counters; // whole test, calling thread
 };
 
 struct TestResult {
@@ -51,60 +377,934 @@ struct TestResult {
     bool passed = true;
     bool skipped = false;
     double duration_ms = 0.0;
-    std::vector<std::string> failures;
+    std::vector<Failure> failures;
+    std::optional<BenchResult> bench; // set for measured BENCH runs
+    std::optional<ResourceUsage> resources; // set with --mt_instrument
+};
+
+// Registration order is link order. Constant-initialized, so TEST objects in
+// any translation unit can link into it during static initialization.
+class TestRegistry {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TestCase;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TestCase*;
+        using reference = const TestCase&;
+
+        iterator() = default;
+        explicit iterator(const TestCase* node) : node_(node) {}
+        reference operator*() const { return *node_; }
+        pointer operator->() const { return node_; }
+        iterator& operator++() { node_ = node_->next; return *this; }
+        iterator operator++(int) { iterator old = *this; node_ = node_->next; return old; }
+        bool operator==(const iterator&) const = default;
+
+    private:
+        const TestCase* node_ = nullptr;
+    };
+
+    constexpr TestRegistry() = default;
+
+    void add(TestCase& node) {
+        node.index = size_++;
+        node.next = nullptr;
+        (tail_ ? tail_->next : head_) = &node;
+        tail_ = &node;
+    }
+
+    // Replaces each TEST_CASES placeholder with its cases and renumbers the
+    // list. run_all_tests calls it first, once every translation unit's
+    // statics are initialized, so a table's size is read only then; later
+    // calls just renumber.
+    void expand_cases() {
+        TestCase* node = head_;
+        head_ = tail_ = nullptr;
+        size_ = 0;
+        while (node) {
+            TestCase* next = node->next;
+            if (node->expand) {
+                for (TestCase& c : node->expand(node->target, *node)) add(c);
+            } else {
+                add(*node);
+            }
+            node = next;
+        }
+    }
+
+    iterator begin() const { return iterator(head_); }
+    iterator end() const { return iterator(); }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    TestCase* head_ = nullptr;
+    TestCase* tail_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+namespace detail {
+constinit inline TestRegistry registry;
+}
+
+inline TestRegistry& get_tests() { return detail::registry; }
+
+// Per-test options, passed after the body:
+//   TEST("Handshake", [] { ... }, mt::timeout{std::chrono::seconds{2}});
+struct timeout {
+    std::chrono::milliseconds limit;
+
+    template <typename Rep, typename Period>
+    constexpr timeout(std::chrono::duration<Rep, Period> d)
+        : limit(std::chrono::duration_cast<std::chrono::milliseconds>(d)) {}
+};
+
+namespace detail {
+inline void apply_option(TestCase& node, const timeout& t) { node.time_limit = t.limit; }
+
+// The runner's view of a fixture: how many declared users are still to run
+// in this iteration, and how to tear it down once none are.
+class FixtureBase {
+public:
+    std::atomic<std::size_t> pending{0};
+    virtual void release() = 0;
+
+protected:
+    ~FixtureBase() = default;
+};
+} // namespace detail
+
+// Expensive setup shared by a group of tests:
+//   inline mt::Fixture assets([] { return AssetIndex::load("assets.idx"); });
+//   TEST("Lookup", [] { expect(assets->find("hero")) != nullptr; }, mt::uses<assets>);
+// The value is built on first use and shared read-only by every worker.
+// The runner runs the tests that use a fixture back to back and tears it
+// down once the last of them has finished; a later iteration builds it
+// again. Fixtures need static storage duration.
+template <typename T, typename Make = T (*)()>
+class Fixture : public detail::FixtureBase {
+public:
+    explicit Fixture(Make make) : make_(std::move(make)) {}
+    Fixture(const Fixture&) = delete;
+    Fixture& operator=(const Fixture&) = delete;
+
+    // A factory that throws fails this and every later user of the same
+    // setup with its exception rather than repeating the setup per test.
+    const T& get() {
+        if (const T* value = value_.load(std::memory_order_acquire)) return *value;
+        detail::LockGuard lock(mutex_);
+        if (error_) std::rethrow_exception(error_);
+        if (!storage_) {
+            trace_scope span("fixture setup", "fixture");
+            try {
+                storage_.reset(new T(make_()));
+            } catch (...) {
+                error_ = std::current_exception();
+                throw;
+            }
+            value_.store(storage_.get(), std::memory_order_release);
+        }
+        return *storage_;
+    }
+    const T& operator*() { return get(); }
+    const T* operator->() { return &get(); }
+    bool ready() const { return value_.load(std::memory_order_acquire) != nullptr; }
+
+    void release() override {
+        detail::LockGuard lock(mutex_);
+        value_.store(nullptr, std::memory_order_relaxed);
+        if (storage_) {
+            trace_scope span("fixture teardown", "fixture");
+            storage_.reset();
+        }
+        error_ = nullptr;
+    }
+
+private:
+    Make make_;
+    detail::Lock mutex_;
+    std::atomic<const T*> value_{nullptr};
+    std::unique_ptr<T> storage_;
+    std::exception_ptr error_;
+};
+
+template <typename Make>
+Fixture(Make) -> Fixture<std::invoke_result_t<Make&>, Make>;
+
+// Declares the fixtures a test uses: TEST("x", body, mt::uses<assets, db>).
+// Only declared users count towards a fixture's lifetime.
+template <auto&... Fixtures>
+struct uses_t {
+    static_assert(sizeof...(Fixtures) > 0, "mt::uses needs at least one fixture");
+    static constexpr detail::FixtureBase* list[] = {&Fixtures...};
+};
+
+template <auto&... Fixtures>
+inline constexpr uses_t<Fixtures...> uses{};
+
+namespace detail {
+template <auto&... Fixtures>
+void apply_option(TestCase& node, const uses_t<Fixtures...>&) { node.fixtures = uses_t<Fixtures...>::list; }
+} // namespace detail
+
+namespace detail {
+// TEST_ASYNC bodies: coroutines returning mt::task<>.
+template <typename F, typename... Args>
+concept async_body = std::is_same_v<std::invoke_result_t<F&, Args...>, task<void>>;
+} // namespace detail
+
+// Holds a test body and its registry node. TEST/BENCH create one static
+// instance per test; the body's kind follows from what it can be called
+// with (BENCH bodies take the BenchState that drives their timed loop).
+template <typename F>
+class Registrar {
+public:
+    template <typename... Options>
+    Registrar(TestStatus status, std::source_location loc, std::string_view name, F fn, const Options&... options)
+        : fn_(std::move(fn)) {
+        node_.name = name;
+        node_.status = status;
+        node_.file = loc.file_name();
+        node_.line = static_cast<int>(loc.line());
+        node_.target = &fn_;
+        if constexpr (std::is_invocable_v<F&, BenchState&>) {
+            node_.kind = TestKind::BENCH;
+            node_.invoke_bench = [](void* target, BenchState& state) { (*static_cast<F*>(target))(state); };
+        } else if constexpr (detail::async_body<F>) {
+            node_.kind = TestKind::ASYNC;
+            node_.invoke_async = [](void* target, std::size_t) { return (*static_cast<F*>(target))(); };
+        } else {
+            static_assert(std::is_invocable_v<F&>, "TEST bodies take no arguments; BENCH bodies take mt::BenchState&");
+            node_.invoke = [](void* target, std::size_t) { (*static_cast<F*>(target))(); };
+        }
+        (detail::apply_option(node_, options), ...);
+        if constexpr (requires { fn_.configure(node_); }) fn_.configure(node_);
+        get_tests().add(node_);
+    }
+
+    Registrar(const Registrar&) = delete;
+    Registrar& operator=(const Registrar&) = delete;
+
+private:
+    F fn_;
+    TestCase node_;
+};
+
+// Holds a TEST_CASES table. Static initialization only links a placeholder
+// node; the table may live in another translation unit and be initialized
+// later, so its size is read when run_all_tests expands the placeholder
+// into one node per element. An lvalue range is referenced, a temporary is
+// moved in; elements are only touched when their case runs, so listing and
+// filtering cost the same as for plain tests.
+template <typename R, typename F>
+class CaseRegistrar {
+    using Range = std::remove_reference_t<R>;
+    static_assert(detail::random_access_range<Range> && detail::sized_range<Range>,
+                  "TEST_CASES needs a sized random-access range (array, vector, span, ...)");
+    static_assert(std::is_invocable_v<F&, detail::range_reference_t<Range>>,
+                  "TEST_CASES bodies take one element of the case range");
+
+public:
+    template <typename... Options>
+    CaseRegistrar(TestStatus status, std::source_location loc, std::string_view name, R&& cases, F fn,
+                  const Options&... options)
+        : cases_(std::forward<R>(cases)), fn_(std::move(fn)) {
+        placeholder_.name = name;
+        placeholder_.status = status;
+        placeholder_.file = loc.file_name();
+        placeholder_.line = static_cast<int>(loc.line());
+        placeholder_.target = this;
+        if constexpr (detail::async_body<F, detail::range_reference_t<Range>>) {
+            placeholder_.kind = TestKind::ASYNC;
+            placeholder_.invoke_async = [](void* target, std::size_t case_number) {
+                return static_cast<CaseRegistrar*>(target)->fn_(static_cast<CaseRegistrar*>(target)->element(case_number));
+            };
+        } else {
+            placeholder_.invoke = [](void* target, std::size_t case_number) {
+                static_cast<CaseRegistrar*>(target)->fn_(static_cast<CaseRegistrar*>(target)->element(case_number));
+            };
+        }
+        placeholder_.expand = &expand;
+        (detail::apply_option(placeholder_, options), ...);
+        get_tests().add(placeholder_);
+    }
+
+    CaseRegistrar(const CaseRegistrar&) = delete;
+    CaseRegistrar& operator=(const CaseRegistrar&) = delete;
+
+private:
+    decltype(auto) element(std::size_t i) {
+        return std::ranges::begin(cases_)[static_cast<std::iter_difference_t<detail::iterator_t<Range>>>(i)];
+    }
+
+    static std::span<TestCase> expand(void* target, const TestCase& placeholder) {
+        auto* self = static_cast<CaseRegistrar*>(target);
+        const auto count = static_cast<std::size_t>(std::ranges::size(self->cases_));
+        self->nodes_ = std::make_unique<TestCase[]>(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            TestCase& node = self->nodes_[i];
+            node = placeholder;
+            node.expand = nullptr;
+            node.case_number = i;
+        }
+        return {self->nodes_.get(), count};
+    }
+
+    R cases_;
+    F fn_;
+    TestCase placeholder_;
+    std::unique_ptr<TestCase[]> nodes_;
+};
+
+template <typename R, typename F, typename... Options>
+CaseRegistrar(TestStatus, std::source_location, std::string_view, R&&, F, const Options&...) -> CaseRegistrar<R, F>;
+
+// --- 3. MOCKING SYSTEM ---
+// Recording policies decide what a Mock keeps per call. Each policy exposes
+// a recorder<Args...> that Mock derives from; recorders provide
+// record(args...), call_count() and, when they keep arguments,
+// was_called_with(args...).
+namespace record {
+
+// Counts calls and keeps nothing else: use when a test only checks
+// to_have_been_called_times.
+struct count_only {
+    template <typename... Args>
+    struct recorder {
+        static constexpr bool keeps_arguments = false;
+
+        void record(const Args&...) { count_++; }
+        std::size_t call_count() const { return count_; }
+
+    private:
+        std::size_t count_ = 0;
+    };
+};
+
+// Keeps the arguments of the last N calls in a fixed ring buffer;
+// was_called_with only sees that window.
+template <std::size_t N>
+struct last {
+    static_assert(N > 0, "record::last<N> needs room for at least one call");
+
+    template <typename... Args>
+    struct recorder {
+        using args_tuple = std::tuple<Args...>;
+        static constexpr bool keeps_arguments = true;
+
+        void record(const Args&... args) { ring_[count_++ % N].emplace(args...); }
+        std::size_t call_count() const { return count_; }
+
+        template <typename... U>
+        bool was_called_with(const U&... expected) const {
+            for (const auto& call : ring_) {
+                if (call && *call == std::forward_as_tuple(expected...)) return true;
+            }
+            return false;
+        }
+
+        // i-th retained call, oldest first
+        const args_tuple& recent(std::size_t i) const {
+            std::size_t kept = std::min(count_, N);
+            return *ring_[(count_ - kept + i) % N];
+        }
+        std::size_t retained() const { return std::min(count_, N); }
+
+    private:
+        std::array<std::optional<args_tuple>, N> ring_{};
+        std::size_t count_ = 0;
+    };
+};
+
+namespace detail {
+// Append-only log in arena chunks that double in size: entries never move,
+// a long log costs a handful of allocations, and memory is released all at
+// once. The chunk table and the log live in one heap block, so a recorder
+// can be moved or swapped without invalidating either; nothing is
+// allocated until the first call. Reads like a std::vector (size, [],
+// front/back, iteration, clear) so Mock::calls keeps its old uses.
+template <typename T>
+class ArenaLog {
+    static constexpr std::size_t first_chunk = 16; // entries; chunk k holds first_chunk << k
+
+public:
+    using value_type = T;
+
+    class const_iterator {
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        const_iterator(const ArenaLog* log, std::size_t i) : log_(log), i_(i) {}
+        reference operator*() const { return (*log_)[i_]; }
+        pointer operator->() const { return &(*log_)[i_]; }
+        const_iterator& operator++() { ++i_; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++i_; return old; }
+        bool operator==(const const_iterator& other) const { return i_ == other.i_; }
+
+    private:
+        const ArenaLog* log_ = nullptr;
+        std::size_t i_ = 0;
+    };
+
+    ArenaLog() = default;
+    ArenaLog(const ArenaLog& other) {
+        for (const auto& entry : other) push(entry);
+    }
+    ArenaLog(ArenaLog&&) noexcept = default;
+    ArenaLog& operator=(ArenaLog other) noexcept {
+        state_.swap(other.state_);
+        return *this;
+    }
+
+    template <typename... A>
+    void push(A&&... args) {
+        if (!state_) state_ = std::make_unique<State>();
+        auto [chunk, offset] = locate(state_->size);
+        if (offset == 0) state_->chunks[chunk] = std::allocator<T>().allocate(first_chunk << chunk);
+        ::new (static_cast<void*>(state_->chunks[chunk] + offset)) T(std::forward<A>(args)...);
+        state_->size++;
+    }
+
+    std::size_t size() const { return state_ ? state_->size : 0; }
+    bool empty() const { return size() == 0; }
+    const T& operator[](std::size_t i) const {
+        auto [chunk, offset] = locate(i);
+        return state_->chunks[chunk][offset];
+    }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[size() - 1]; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, size()}; }
+    void clear() { state_.reset(); } // also hands the arena back
+
+private:
+    struct Location {
+        std::size_t chunk, offset;
+    };
+    // Chunk k starts at entry first_chunk * (2^k - 1).
+    static Location locate(std::size_t i) {
+        auto chunk = static_cast<std::size_t>(std::bit_width(i / first_chunk + 1) - 1);
+        return {chunk, i - first_chunk * ((std::size_t{1} << chunk) - 1)};
+    }
+
+    struct State {
+        State() = default;
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+        ~State() {
+            for (std::size_t i = 0; i < size; ++i) {
+                auto [chunk, offset] = locate(i);
+                chunks[chunk][offset].~T();
+            }
+            for (std::size_t k = 0; k < chunks.size() && chunks[k]; ++k) std::allocator<T>().deallocate(chunks[k], first_chunk << k);
+        }
+        std::array<T*, 48> chunks{};
+        std::size_t size = 0;
+    };
+    std::unique_ptr<State> state_;
+};
+
+// Default fingerprint: combined std::hash of every argument.
+struct hash_args {
+    template <typename... A>
+    std::size_t operator()(const A&... args) const {
+        std::size_t seed = 0;
+        ((seed ^= std::hash<A>{}(args) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)), ...);
+        return seed;
+    }
 };
+} // namespace detail
+
+// Keeps a copy of every call's arguments in an arena (the default).
+// `calls` is the same public member the single-policy Mock had; it is an
+// ArenaLog now rather than a std::vector.
+struct all {
+    template <typename... Args>
+    struct recorder {
+        using args_tuple = std::tuple<Args...>;
+        static constexpr bool keeps_arguments = true;
+
+        detail::ArenaLog<args_tuple> calls;
+
+        void record(const Args&... args) { calls.push(args...); }
+        std::size_t call_count() const { return calls.size(); }
+
+        template <typename... U>
+        bool was_called_with(const U&... expected) const {
+            for (const auto& call : calls) {
+                if (call == std::forward_as_tuple(expected...)) return true;
+            }
+            return false;
+        }
+    };
+};
+
+// Keeps only Projection(args...) per call, e.g. a hash of a large buffer or
+// the result of a predicate, instead of copying the arguments themselves.
+// was_called_with(args...) projects the expected arguments the same way.
+template <typename Projection>
+struct project {
+    template <typename... Args>
+    struct recorder {
+        using value_type = std::invoke_result_t<Projection, const Args&...>;
+        static constexpr bool keeps_arguments = true;
+
+        void record(const Args&... args) { log_.push(Projection{}(args...)); }
+        std::size_t call_count() const { return log_.size(); }
+
+        template <typename... U>
+        bool was_called_with(const U&... expected) const {
+            auto key = Projection{}(expected...);
+            for (const auto& value : log_) {
+                if (value == key) return true;
+            }
+            return false;
+        }
+
+        const detail::ArenaLog<value_type>& recorded() const { return log_; }
+
+    private:
+        detail::ArenaLog<value_type> log_;
+    };
+};
+
+// One std::hash fingerprint per call.
+using fingerprint = project<detail::hash_args>;
+
+} // namespace record
+
+namespace detail {
+// What a mock does when called: a copyable, nullable type-erased callable,
+// the part of std::function the mocks use, without <functional>. Empty
+// std::functions and null function pointers stay empty.
+template <typename Signature>
+class Behavior;
+
+template <typename Ret, typename... Args>
+class Behavior<Ret(Args...)> {
+public:
+    Behavior() = default;
+    Behavior(std::nullptr_t) {}
+    template <typename F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, Behavior> && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...>)
+    Behavior(F&& f) {
+        using D = std::decay_t<F>;
+        if constexpr (std::is_pointer_v<D> || requires(const D& d) { d == nullptr; }) {
+            if (f == nullptr) return;
+        }
+        target_ = std::make_unique<Model<D>>(std::forward<F>(f));
+    }
+    Behavior(const Behavior& other) : target_(other.target_ ? other.target_->clone() : nullptr) {}
+    Behavior(Behavior&&) noexcept = default;
+    Behavior& operator=(Behavior other) noexcept {
+        target_.swap(other.target_);
+        return *this;
+    }
+
+    explicit operator bool() const { return target_ != nullptr; }
+    Ret operator()(Args... args) const { return target_->call(std::forward<Args>(args)...); }
+
+private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual Ret call(Args... args) = 0;
+        virtual std::unique_ptr<Concept> clone() const = 0;
+    };
+    template <typename F>
+    struct Model final : Concept {
+        template <typename G>
+        explicit Model(G&& g) : fn(std::forward<G>(g)) {}
+        Ret call(Args... args) override {
+            if constexpr (std::is_void_v<Ret>) fn(std::forward<Args>(args)...);
+            else return fn(std::forward<Args>(args)...);
+        }
+        std::unique_ptr<Concept> clone() const override { return std::make_unique<Model>(fn); }
+        F fn;
+    };
+    std::unique_ptr<Concept> target_;
+};
+} // namespace detail
+
+template<typename Signature, typename Policy = record::all> struct Mock;
+
+template<typename Ret, typename... Args, typename Policy>
+struct Mock<Ret(Args...), Policy> : Policy::template recorder<std::decay_t<Args>...> {
+    detail::Behavior<Ret(Args...)> behavior;
+
+    Mock() = default;
+    Mock(detail::Behavior<Ret(Args...)> f) : behavior(std::move(f)) {}
+
+    Ret operator()(Args... args) {
+        this->record(args...);
+        if (behavior) return behavior(std::forward<Args>(args)...);
+        if constexpr (!std::is_void_v<Ret>) return Ret{};
+    }
+};
+
+template<typename Signature, typename Policy = record::all>
+Mock<Signature, Policy> mock(detail::Behavior<Signature> f = {}) { return Mock<Signature, Policy>(std::move(f)); }
+
+namespace detail {
+inline std::uint64_t next_mock_id() {
+    static std::atomic<std::uint64_t> id{0};
+    return ++id;
+}
+} // namespace detail
+
+// Mock for code that calls it from many threads. The call count is one
+// atomic; arguments go to a per-thread recorder (same policies as Mock), so
+// callers never contend on a lock. The per-thread logs are merged lazily
+// when an expectation inspects them, which must happen after the calling
+// threads are done (joined, or otherwise synchronized with the test).
+// `behavior` is invoked concurrently and must be thread-safe itself.
+template<typename Signature, typename Policy = record::all> struct ConcurrentMock;
+
+template<typename Ret, typename... Args, typename Policy>
+struct ConcurrentMock<Ret(Args...), Policy> {
+    using recorder_type = typename Policy::template recorder<std::decay_t<Args>...>;
+    static constexpr bool keeps_arguments = recorder_type::keeps_arguments;
+
+    detail::Behavior<Ret(Args...)> behavior;
+
+    ConcurrentMock() = default;
+    ConcurrentMock(detail::Behavior<Ret(Args...)> f) : behavior(std::move(f)) {}
+    ConcurrentMock(const ConcurrentMock&) = delete;
+    ConcurrentMock& operator=(const ConcurrentMock&) = delete;
+
+    ~ConcurrentMock() {
+        for (Shard* s = shards_.load(std::memory_order_acquire); s; ) {
+            Shard* next = s->next;
+            delete s;
+            s = next;
+        }
+    }
+
+    Ret operator()(Args... args) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        if constexpr (keeps_arguments) local_shard().recorder.record(args...);
+        if (behavior) return behavior(std::forward<Args>(args)...);
+        if constexpr (!std::is_void_v<Ret>) return Ret{};
+    }
+
+    std::size_t call_count() const { return count_.load(std::memory_order_acquire); }
+
+    template <typename... U>
+    bool was_called_with(const U&... expected) const requires keeps_arguments {
+        for (const Shard* s = shards_.load(std::memory_order_acquire); s; s = s->next) {
+            if (s->recorder.was_called_with(expected...)) return true;
+        }
+        return false;
+    }
+
+    // Visits each calling thread's recorder.
+    template <typename F>
+    void for_each_thread(F&& fn) const {
+        for (const Shard* s = shards_.load(std::memory_order_acquire); s; s = s->next) fn(s->recorder);
+    }
+
+private:
+    struct Shard {
+        recorder_type recorder;
+        const void* owner; // detail::thread_tag() of the recording thread
+        Shard* next = nullptr;
+    };
+
+    // One-entry thread-local cache, keyed by a process-unique id rather than
+    // the address so a new mock at a recycled address never hits a stale entry.
+    Shard& local_shard() {
+        thread_local std::uint64_t cached_id = 0;
+        thread_local Shard* cached = nullptr;
+        if (cached_id == id_) return *cached;
+
+        const void* self = detail::thread_tag();
+        Shard* head = shards_.load(std::memory_order_acquire);
+        Shard* mine = nullptr;
+        for (Shard* s = head; s; s = s->next) {
+            if (s->owner == self) { mine = s; break; }
+        }
+        if (!mine) {
+            mine = new Shard{recorder_type{}, self, head};
+            while (!shards_.compare_exchange_weak(mine->next, mine,
+                                                  std::memory_order_release, std::memory_order_acquire)) {}
+        }
+        cached_id = id_;
+        cached = mine;
+        return *mine;
+    }
+
+    std::atomic<Shard*> shards_{nullptr};
+    std::atomic<std::size_t> count_{0};
+    const std::uint64_t id_ = detail::next_mock_id();
+};
+
+template<typename Signature, typename Policy = record::all>
+ConcurrentMock<Signature, Policy> concurrent_mock(detail::Behavior<Signature> f = {}) {
+    return ConcurrentMock<Signature, Policy>(std::move(f));
+}
+
+// --- 4. INSTRUMENTATION ---
+// Allocation counters for the calling thread. The replaceable global
+// operator new/delete in the ModernTest_Runner library bump them; without
+// the runner (or with MODERNTEST_ALLOC_HOOKS off) they stay at zero and
+// alloc_hooks_installed() is false.
+struct AllocCounters {
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+};
+
+namespace detail {
+inline thread_local AllocCounters alloc_counters;
+inline std::atomic<bool> alloc_hooks_active{false};
+} // namespace detail
+
+inline AllocCounters thread_allocations() { return detail::alloc_counters; }
+inline bool alloc_hooks_installed() { return detail::alloc_hooks_active.load(std::memory_order_relaxed); }
+
+// --- 5. ASSERTIONS ---
+// Failure paths are kept out of line so the passing path of every matcher
+// is a comparison and a branch: no allocation, no stream construction.
+#if defined(__GNUC__) || defined(__clang__)
+#define MT_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#define MT_COLD __declspec(noinline)
+#else
+#define MT_COLD
+#endif
+
+// Entry points that record where they were called from. In optimized GCC
+// and Clang builds on x86-64 and AArch64 they are forced inline and read
+// the program counter, which costs one instruction per assertion and is
+// distinct for every inlined copy. Elsewhere they stay out of line so every
+// call has a return address of its own.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__OPTIMIZE__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+#define MT_CALL_SITE_ENTRY [[gnu::always_inline]] inline
+#define MT_CALLER_ADDRESS() ::mt::detail::program_counter()
+namespace detail {
+[[gnu::always_inline]] inline const void* program_counter() {
+    const void* pc;
+#if defined(__x86_64__)
+    asm volatile("lea 0(%%rip), %0" : "=r"(pc));
+#else
+    asm volatile("adr %0, ." : "=r"(pc));
+#endif
+    return pc;
+}
+} // namespace detail
+#elif defined(__GNUC__) || defined(__clang__)
+#define MT_CALL_SITE_ENTRY [[gnu::noinline]]
+#define MT_CALLER_ADDRESS() __builtin_extract_return_addr(__builtin_return_address(0))
+#elif defined(_MSC_VER)
+#define MT_CALL_SITE_ENTRY __declspec(noinline)
+#define MT_CALLER_ADDRESS() _ReturnAddress()
+#else
+#define MT_CALL_SITE_ENTRY
+#define MT_CALLER_ADDRESS() nullptr
+#endif
+
+namespace detail {
+// True once the running test has used up max_failures_per_test: the
+// failure is counted and nothing is formatted or stored. Matchers check
+// this before building their message.
+MT_COLD inline bool failure_suppressed() {
+    auto& ctx = current_test();
+    if (max_failures_per_test == 0 || ctx.recorded < max_failures_per_test) return false;
+    ctx.failed = true;
+    ctx.suppressed++;
+    return true;
+}
 
-inline std::vector<TestCase>& get_tests() {
-    static std::vector<TestCase> tests;
-    return tests;
+// Messages that differ only inside their [value] brackets: a repeat of one
+// assertion with other values. A failure folds into an earlier entry only
+// when file, line, FailureSite and this shape all agree.
+inline bool same_failure_shape(std::string_view a, std::string_view b) {
+    auto skip_value = [](std::string_view s, std::size_t i) {
+        for (int depth = 0; i < s.size(); ++i) {
+            if (s[i] == '[') depth++;
+            else if (s[i] == ']' && --depth == 0) return i + 1;
+        }
+        return i;
+    };
+    std::size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] != b[j]) return false;
+        if (a[i] == '[') {
+            i = skip_value(a, i);
+            j = skip_value(b, j);
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+    return i == a.size() && j == b.size();
 }
 
-inline std::vector<TestResult>& get_results() {
-    static std::vector<TestResult> results;
-    return results;
+MT_COLD inline void record_failure(std::string_view file, int line, std::string_view msg, FailureSite site = {}) {
+    if (failure_suppressed()) return;
+    auto& ctx = current_test();
+    ctx.failed = true;
+    ctx.recorded++;
+    auto publish = [&](const Failure& f) {
+        if (!ctx.live) return;
+        if (auto sink = failure_sink.load(std::memory_order_acquire)) sink(*ctx.live, f);
+    };
+    for (std::size_t i = 0; i < ctx.failures.size() && i < ctx.sites.size(); ++i) {
+        auto& f = ctx.failures[i];
+        if (ctx.sites[i] != site || f.line != line || f.file != file || !same_failure_shape(f.message, msg)) continue;
+        f.hits++;
+        if (f.recent.size() == recent_failure_messages) f.recent.erase(f.recent.begin());
+        f.recent.emplace_back(msg);
+        publish(f);
+        return;
+    }
+    ctx.sites.resize(ctx.failures.size());
+    ctx.failures.push_back({std::string(file), line, std::string(msg), 1, {}});
+    ctx.sites.push_back(site);
+    publish(ctx.failures.back());
 }
 
-// Filter pattern for --mt_filter or --gtest_filter
-inline std::string test_filter_pattern;
-inline std::string xml_output_path;
+MT_COLD inline void record_failure(const std::source_location& loc, std::string_view msg,
+                                   const void* caller = nullptr) {
+    record_failure(loc.file_name(), static_cast<int>(loc.line()), msg,
+                   {caller, static_cast<std::uint_least32_t>(loc.column())});
+}
 
-struct Registrar {
-    Registrar(std::string_view name, std::function<void()> func, TestStatus status,
-              std::source_location loc = std::source_location::current()) {
-        get_tests().push_back({name, func, status, loc.file_name(), static_cast<int>(loc.line())});
-    }
+// Range matchers name at most this many mismatching indices.
+inline constexpr std::size_t range_mismatch_limit = 8;
+
+template <typename R>
+using range_element_t = std::remove_cvref_t<range_reference_t<const R>>;
+
+// Both sides are contiguous buffers of the same scalar type without padding
+// bits, so equality is one memcmp. Class types always go through their
+// operator==, which may compare less (or more) than the bytes.
+template <typename A, typename B>
+inline constexpr bool bitwise_comparable_ranges =
+    contiguous_range<const A> && contiguous_range<const B> &&
+    std::is_same_v<range_element_t<A>, range_element_t<B>> &&
+    std::is_scalar_v<range_element_t<A>> &&
+    std::has_unique_object_representations_v<range_element_t<A>>;
+} // namespace detail
+
+// Tolerance for to_be_approx_range. Elements match when they are equal or
+// when any bound holds: |a - b| <= abs, |a - b| <= rel * max(|a|, |b|), or
+// a and b are at most `ulps` representable values apart. NaN never matches.
+//   expect(pixels).to_be_approx_range(golden, {.rel = 1e-5});
+//   expect(vertices).to_be_approx_range(reference, {.abs = 1e-6, .ulps = 4});
+struct tolerance {
+    double abs = 0.0;
+    double rel = 0.0;
+    std::uint64_t ulps = 0;
 };
 
-// --- 3. MOCKING SYSTEM ---
-template<typename Signature> struct Mock;
+namespace detail {
+// Maps a float or double onto a signed integer line where adjacent values
+// differ by one and -0 meets +0.
+template <typename T>
+std::int64_t ordered_bits(T x) {
+    if constexpr (sizeof(T) == sizeof(std::int32_t)) {
+        auto bits = std::bit_cast<std::int32_t>(x);
+        return bits < 0 ? -static_cast<std::int64_t>(bits & 0x7fffffff) : bits;
+    } else {
+        auto bits = std::bit_cast<std::int64_t>(static_cast<double>(x));
+        return bits < 0 ? -(bits & 0x7fffffffffffffff) : bits;
+    }
+}
 
-template<typename Ret, typename... Args>
-struct Mock<Ret(Args...)> {
-    using args_tuple = std::tuple<Args...>;
-    std::vector<args_tuple> calls;
-    std::function<Ret(Args...)> behavior;
+template <typename T>
+std::uint64_t ulp_distance(T a, T b) {
+    std::int64_t x = ordered_bits(a), y = ordered_bits(b);
+    // Unsigned subtraction: the distance can exceed INT64_MAX.
+    return x > y ? static_cast<std::uint64_t>(x) - static_cast<std::uint64_t>(y)
+                 : static_cast<std::uint64_t>(y) - static_cast<std::uint64_t>(x);
+}
 
-    Mock() = default;
-    Mock(std::function<Ret(Args...)> f) : behavior(f) {}
+// Written with `|` rather than `||` so the kernels below stay branch-free.
+template <typename T>
+bool approx_equal(const T& a, const T& b, const tolerance& tol) {
+    if constexpr (std::is_floating_point_v<T>) {
+        T d = std::abs(a - b);
+        bool ok = a == b; // false for NaN, true for matching infinities
+        ok |= d <= static_cast<T>(tol.abs);
+        ok |= d <= static_cast<T>(tol.rel) * std::max(std::abs(a), std::abs(b));
+        ok |= (tol.ulps != 0) & (a == a) & (b == b) & (ulp_distance(a, b) <= tol.ulps);
+        return ok;
+    } else {
+        // Integers are one ULP apart.
+        double d = std::abs(static_cast<double>(a) - static_cast<double>(b));
+        return d <= tol.abs || d <= static_cast<double>(tol.ulps) ||
+               d <= tol.rel * std::max(std::abs(static_cast<double>(a)), std::abs(static_cast<double>(b)));
+    }
+}
 
-    Ret operator()(Args... args) {
-        calls.push_back(std::make_tuple(args...));
-        if (behavior) return behavior(args...);
-        if constexpr (!std::is_void_v<Ret>) return Ret{};
+// Branch-free per block so the compiler can vectorize it; only a block that
+// contains a mismatch is rescanned for indices. An absolute-only tolerance
+// keeps the cheaper two-compare kernel.
+template <typename T>
+bool spans_approx_equal(const T* a, const T* b, std::size_t n, const tolerance& tol) {
+    constexpr std::size_t block = 256;
+    const bool absolute_only = tol.rel == 0.0 && tol.ulps == 0;
+    const T eps = static_cast<T>(tol.abs);
+    for (std::size_t start = 0; start < n; start += block) {
+        std::size_t end = std::min(n, start + block);
+        bool bad = false;
+        if (absolute_only) {
+            for (std::size_t i = start; i < end; ++i) bad |= !((std::abs(a[i] - b[i]) <= eps) | (a[i] == b[i]));
+        } else {
+            for (std::size_t i = start; i < end; ++i) bad |= !approx_equal(a[i], b[i], tol);
+        }
+        if (bad) return false;
     }
-};
+    return true;
+}
 
-template<typename Signature>
-Mock<Signature> mock(std::function<Signature> f = {}) { return Mock<Signature>(f); }
+// Builds the failure message from a second, element-wise pass: the matcher
+// already knows the ranges differ, so this only runs on failure.
+template <typename A, typename B, typename Eq>
+MT_COLD std::string describe_range_mismatch(const A& actual, const B& expected, Eq&& eq) {
+    std::size_t na = static_cast<std::size_t>(std::ranges::distance(actual));
+    std::size_t nb = static_cast<std::size_t>(std::ranges::distance(expected));
+    MessageStream oss;
+    if (na != nb) oss << "Range sizes differ: " << na << " vs " << nb << "; ";
+    std::size_t mismatches = 0;
+    MessageStream first;
+    auto a = std::ranges::begin(actual);
+    auto b = std::ranges::begin(expected);
+    for (std::size_t i = 0; i < std::min(na, nb); ++i, ++a, ++b) {
+        if (eq(*a, *b)) continue;
+        if (mismatches++ >= range_mismatch_limit) continue;
+        first << (mismatches > 1 ? ", " : "") << '[' << i << ']';
+        if constexpr (requires(std::ostream& os) { os << *a << *b; }) first << ' ' << *a << " vs " << *b;
+    }
+    oss << mismatches << " of " << std::min(na, nb) << " element(s) differ";
+    if (mismatches > 0) {
+        oss << "; first " << std::min(mismatches, range_mismatch_limit) << ": " << first.str();
+    }
+    return oss.str();
+}
+} // namespace detail
 
-// --- 4. ASSERTIONS ---
+// T is a reference for lvalues passed to expect(), so containers and mocks
+// are inspected in place; temporaries are moved into owned storage.
 template <typename T>
 struct Expectation {
+    using value_type = std::remove_cvref_t<T>;
+
     T val;
     std::source_location loc;
+    const void* caller = nullptr; // where expect() was called, for folding
     bool inverted = false;
 
-    Expectation(T v, std::source_location l) : val(v), loc(l) {}
+    Expectation(T&& v, std::source_location l, const void* c = nullptr)
+        : val(std::forward<T>(v)), loc(l), caller(c) {}
 
     // Fluent Negation
     Expectation& Not() { inverted = !inverted; return *this; }
@@ -117,7 +1317,7 @@ struct Expectation {
 
     // --- Container Matchers ---
     template <typename E>
-    void to_contain(const E& element) requires std::ranges::range<T> {
+    void to_contain(const E& element) requires detail::range<value_type> {
         auto it = std::find(val.begin(), val.end(), element);
         bool found = (it != val.end());
         
@@ -127,7 +1327,60 @@ struct Expectation {
         }
     }
 
-    void is_empty() requires requires(T t) { t.empty(); } {
+    // Whole-range equality through each element's operator==. Contiguous
+    // buffers of integers, enums or pointers compare with one memcmp.
+    template <detail::sized_range R>
+    void to_equal_range(const R& expected) requires detail::sized_range<value_type> {
+        bool equal = std::ranges::size(val) == std::ranges::size(expected);
+        if (equal) {
+            if constexpr (detail::bitwise_comparable_ranges<value_type, R>) {
+                std::size_t bytes = std::ranges::size(val) * sizeof(detail::range_element_t<R>);
+                equal = bytes == 0 || std::memcmp(std::ranges::data(val), std::ranges::data(expected), bytes) == 0;
+            } else {
+                equal = std::ranges::equal(val, expected);
+            }
+        }
+        if (inverted == equal) [[unlikely]] {
+            if (inverted) fail("Expected ranges NOT to be equal");
+            else fail_with([&] { return detail::describe_range_mismatch(val, expected, [](const auto& a, const auto& b) { return a == b; }); });
+        }
+    }
+
+    // Element-wise |a - b| <= eps over arithmetic ranges; NaN never matches.
+    template <detail::sized_range R>
+    void to_be_approx_range(const R& expected, double eps) requires detail::sized_range<value_type> &&
+        std::is_arithmetic_v<detail::range_element_t<value_type>> && std::is_arithmetic_v<detail::range_element_t<R>> {
+        to_be_approx_range(expected, tolerance{.abs = eps});
+    }
+
+    // Element-wise comparison with absolute, relative and ULP bounds (see
+    // mt::tolerance). Contiguous float/double buffers go through a
+    // vectorizable kernel.
+    template <detail::sized_range R>
+    void to_be_approx_range(const R& expected, const tolerance& tol) requires detail::sized_range<value_type> &&
+        std::is_arithmetic_v<detail::range_element_t<value_type>> && std::is_arithmetic_v<detail::range_element_t<R>> {
+        using E = detail::range_element_t<R>;
+        auto near = [tol](const auto& a, const auto& b) {
+            using C = std::common_type_t<std::remove_cvref_t<decltype(a)>, std::remove_cvref_t<decltype(b)>>;
+            return detail::approx_equal<C>(static_cast<C>(a), static_cast<C>(b), tol);
+        };
+        bool equal = std::ranges::size(val) == std::ranges::size(expected);
+        if (equal) {
+            if constexpr (detail::contiguous_range<const value_type> && detail::contiguous_range<const R> &&
+                          std::is_same_v<detail::range_element_t<value_type>, E> && std::is_floating_point_v<E>) {
+                equal = detail::spans_approx_equal(std::ranges::data(val), std::ranges::data(expected),
+                                                   std::ranges::size(expected), tol);
+            } else {
+                equal = std::ranges::equal(val, expected, near);
+            }
+        }
+        if (inverted == equal) [[unlikely]] {
+            if (inverted) fail("Expected ranges NOT to be approximately equal");
+            else fail_with([&] { return detail::describe_range_mismatch(val, expected, near); });
+        }
+    }
+
+    void is_empty() requires requires(const value_type& t) { t.empty(); } {
         bool empty = val.empty();
         if (inverted == empty) {
             fail(inverted ? "Expected container NOT to be empty" 
@@ -136,320 +1389,896 @@ struct Expectation {
     }
 
     // --- Mock Matchers ---
-    void to_have_been_called_times(size_t n) {
-        // We assume T is a Mock object with a .calls member
-        bool match = (val.calls.size() == n);
+    void to_have_been_called_times(size_t n) requires requires(const value_type& m) { m.call_count(); } {
+        bool match = (val.call_count() == n);
+        if (inverted == match) {
+            fail_with([&] { return "Mock call count mismatch. Actual: " + std::to_string(val.call_count()); });
+        }
+    }
+
+    // Needs a recording policy that keeps arguments (not record::count_only).
+    template <typename... A>
+    void to_have_been_called_with(const A&... args) requires value_type::keeps_arguments {
+        bool match = val.was_called_with(args...);
         if (inverted == match) {
-            fail("Mock call count mismatch. Actual: " + std::to_string(val.calls.size()));
+            fail(inverted ? "Expected mock NOT to have been called with the given arguments"
+                          : "Expected mock to have been called with the given arguments");
+        }
+    }
+
+    // --- Latency Matchers ---
+    // Calls the function `runs` times and checks the given percentile of the
+    // per-call wall time against the budget.
+    template <typename Rep, typename Period>
+    void to_complete_within(std::chrono::duration<Rep, Period> budget, double percentile = 0.99, int runs = 1000)
+        requires std::invocable<value_type&> {
+        runs = std::max(runs, 1);
+        percentile = std::clamp(percentile, 0.0, 1.0);
+        std::vector<double> samples_ns(static_cast<std::size_t>(runs));
+        for (auto& sample : samples_ns) {
+            auto start = std::chrono::high_resolution_clock::now();
+            val();
+            auto end = std::chrono::high_resolution_clock::now();
+            sample = std::chrono::duration<double, std::nano>(end - start).count();
+        }
+        auto rank = static_cast<std::size_t>(std::ceil(percentile * static_cast<double>(runs)));
+        auto nth = samples_ns.begin() + static_cast<std::ptrdiff_t>(std::clamp<std::size_t>(rank, 1, samples_ns.size()) - 1);
+        std::nth_element(samples_ns.begin(), nth, samples_ns.end());
+        double budget_ns = std::chrono::duration<double, std::nano>(budget).count();
+        bool within = *nth <= budget_ns;
+        if (inverted == within) [[unlikely]] {
+            fail_latency(*nth, budget_ns, percentile, runs);
         }
     }
 
 private:
+    MT_COLD void fail_latency(double measured_ns, double budget_ns, double percentile, int runs) {
+        if (detail::failure_suppressed()) return;
+        detail::MessageStream oss;
+        oss.setf(std::ios_base::fixed, std::ios_base::floatfield);
+        oss.precision(1);
+        oss
+            << "Expected p" << percentile * 100.0
+            << (inverted ? " latency above " : " latency within ") << budget_ns / 1000.0 << " us, measured "
+            << measured_ns / 1000.0 << " us over " << runs << " runs";
+        fail(oss.str());
+    }
+
     template <typename U>
     void check(const U& rhs, std::string_view op, bool raw_result) {
-        bool final_result = inverted ? !raw_result : raw_result;
-        if (!final_result) {
-            std::ostringstream oss;
-            oss << (inverted ? "Expected NOT " : "Expected ")
-                << "[" << val << "] " << op << " [" << rhs << "]";
-            
-            // IDE-clickable format: file:line: error: message
-            std::cout << "\t" << loc.file_name() << ":" << loc.line() << ": " 
-                      << RED() << "error: " << RESET() << oss.str() << "\n";
-            
-            failure_messages.push_back(
-                std::string(loc.file_name()) + ":" + std::to_string(loc.line()) + ": " + oss.str()
-            );
-            current_test_failed = true;
-        }
-    }
-
-    void fail(std::string_view msg) {
-        // IDE-clickable format: file:line: error: message
-        std::cout << "\t" << loc.file_name() << ":" << loc.line() << ": " 
-                  << RED() << "error: " << RESET() << std::string(msg) << "\n";
-        
-        failure_messages.push_back(
-            std::string(loc.file_name()) + ":" + std::to_string(loc.line()) + ": " + std::string(msg)
-        );
-        current_test_failed = true;
+        if (raw_result == inverted) [[unlikely]] {
+            fail_comparison(rhs, op);
+        }
+    }
+
+    template <typename U>
+    MT_COLD void fail_comparison(const U& rhs, std::string_view op) {
+        if (detail::failure_suppressed()) return;
+        detail::MessageStream oss;
+        oss << (inverted ? "Expected NOT " : "Expected ")
+            << "[" << val << "] " << op << " [" << rhs << "]";
+        fail(oss.str());
+    }
+
+    void fail(std::string_view msg) { detail::record_failure(loc, msg, caller); }
+
+    // Builds the message only while the test still records failures.
+    template <typename Make>
+    MT_COLD void fail_with(Make&& make) {
+        if (!detail::failure_suppressed()) fail(make());
     }
 };
 
 template <typename T>
-Expectation<T> expect(T value, std::source_location loc = std::source_location::current()) {
-    return Expectation<T>(value, loc);
-}
-
-// --- 5. UTILITIES ---
-inline bool matches_filter(std::string_view name, const std::string& pattern) {
-    if (pattern.empty()) return true;
-    
-    // Convert glob pattern to regex: * -> .*, ? -> .
-    std::string regex_pattern;
-    for (char c : pattern) {
-        switch (c) {
-            case '*': regex_pattern += ".*"; break;
-            case '?': regex_pattern += "."; break;
-            case '.': case '(': case ')': case '[': case ']':
-            case '{': case '}': case '^': case '$': case '+':
-            case '|': case '\\': 
-                regex_pattern += '\\'; 
-                regex_pattern += c; 
-                break;
-            default: regex_pattern += c;
-        }
+MT_CALL_SITE_ENTRY Expectation<T> expect(T&& value, std::source_location loc = std::source_location::current()) {
+    return Expectation<T>(std::forward<T>(value), loc, MT_CALLER_ADDRESS());
+}
+
+// Allocation budgets: run fn once and count the heap allocations it makes on
+// this thread.
+// The counts come from the runner's operator new, so these fail outright
+// when the hooks are not linked in.
+namespace detail {
+template <typename F>
+void check_allocations(std::uint64_t limit, F&& fn, const std::source_location& loc, const void* caller) {
+    if (!alloc_hooks_installed()) [[unlikely]] {
+        record_failure(loc, "Allocation hooks are not linked in (link ModernTest::Runner with MODERNTEST_ALLOC_HOOKS)",
+                       caller);
+        return;
     }
-    
-    try {
-        std::regex re(regex_pattern, std::regex::icase);
-        return std::regex_search(name.begin(), name.end(), re);
-    } catch (...) {
-        return name.find(pattern) != std::string_view::npos;
+    AllocCounters before = alloc_counters;
+    std::forward<F>(fn)();
+    AllocCounters after = alloc_counters;
+    std::uint64_t count = after.count - before.count;
+    if (count > limit) [[unlikely]] {
+        record_failure(loc, "Expected at most " + std::to_string(limit) + " allocation(s), got " +
+                                std::to_string(count) + " (" + std::to_string(after.bytes - before.bytes) + " bytes)",
+                       caller);
     }
 }
+} // namespace detail
 
-inline bool matches_test_filters(const TestCase& test) {
-    if (matches_filter(test.name, test_filter_pattern)) {
-        return true;
+template <std::invocable F>
+MT_CALL_SITE_ENTRY void expect_allocations_at_most(std::uint64_t limit, F&& fn,
+                                                   std::source_location loc = std::source_location::current()) {
+    detail::check_allocations(limit, std::forward<F>(fn), loc, MT_CALLER_ADDRESS());
+}
+
+template <std::invocable F>
+MT_CALL_SITE_ENTRY void expect_no_allocations(F&& fn, std::source_location loc = std::source_location::current()) {
+    detail::check_allocations(0, std::forward<F>(fn), loc, MT_CALLER_ADDRESS());
+}
+
+// --- 6. BENCHMARKS ---
+// Keeps `value` (and everything it points to) observable so the optimizer
+// cannot drop the computation that produced it.
+#if defined(__GNUC__) || defined(__clang__)
+template <typename T>
+inline void do_not_optimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void do_not_optimize(T& value) {
+    if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*)) {
+        asm volatile("" : "+r"(value) : : "memory");
+    } else {
+        asm volatile("" : "+m"(value) : : "memory");
     }
-    std::string prefixed = std::string(default_suite_name) + "." + std::string(test.name);
-    return matches_filter(prefixed, test_filter_pattern);
-}
-
-inline std::string escape_xml(const std::string& str) {
-    std::string result;
-    for (char c : str) {
-        switch (c) {
-            case '&':  result += "&amp;"; break;
-            case '<':  result += "&lt;"; break;
-            case '>':  result += "&gt;"; break;
-            case '"':  result += "&quot;"; break;
-            case '\'': result += "&apos;"; break;
-            default:   result += c;
-        }
-    }
-    return result;
-}
-
-inline void write_junit_xml(const std::string& path, double total_time_ms) {
-    auto& results = get_results();
-    std::ofstream out(path);
-    if (!out) return;
-    
-    int failures = 0, skipped = 0;
-    for (const auto& r : results) {
-        if (r.skipped) skipped++;
-        else if (!r.passed) failures++;
-    }
-    
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-    out << "<testsuites tests=\"" << results.size() 
-        << "\" failures=\"" << failures 
-        << "\" skipped=\"" << skipped
-        << "\" time=\"" << (total_time_ms / 1000.0) << "\">\n";
-    out << "  <testsuite name=\"ModernTest\" tests=\"" << results.size() 
-        << "\" failures=\"" << failures 
-        << "\" skipped=\"" << skipped
-        << "\" time=\"" << (total_time_ms / 1000.0) << "\">\n";
-    
-    for (const auto& r : results) {
-        out << "    <testcase name=\"" << escape_xml(r.name) 
-            << "\" file=\"" << escape_xml(r.file) 
-            << "\" line=\"" << r.line
-            << "\" time=\"" << (r.duration_ms / 1000.0) << "\"";
-        
-        if (r.skipped) {
-            out << ">\n      <skipped/>\n    </testcase>\n";
-        } else if (!r.passed) {
-            out << ">\n";
-            for (const auto& f : r.failures) {
-                out << "      <failure message=\"" << escape_xml(f) << "\"/>\n";
-            }
-            out << "    </testcase>\n";
-        } else {
-            out << "/>\n";
+}
+
+// Forces pending writes to memory to be treated as observable.
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+#else
+namespace detail {
+inline void use_char_pointer(char const volatile*) {}
+}
+
+template <typename T>
+inline void do_not_optimize(T const& value) {
+    detail::use_char_pointer(&reinterpret_cast<char const volatile&>(value));
+    _ReadWriteBarrier();
+}
+
+inline void clobber_memory() { _ReadWriteBarrier(); }
+#endif
+
+namespace detail {
+// Hardware counters that count while a BenchState is timing; attached by
+// the runner with --mt_perf_counters.
+class CounterGroup {
+public:
+    virtual void enable() = 0;
+    virtual void disable() = 0;
+
+protected:
+    ~CounterGroup() = default;
+};
+} // namespace detail
+
+// Passed to every BENCH body, which times its own `for (auto _ : state)` loop.
+// The runner decides how many iterations a run gets; code outside the loop
+// (setup, teardown) is not timed.
+class BenchState {
+public:
+    using clock = std::chrono::high_resolution_clock;
+
+    explicit BenchState(std::uint64_t iterations) : iterations_(iterations) {}
+
+    struct [[maybe_unused]] Value {};
+
+    class iterator {
+    public:
+        iterator(BenchState* state, std::uint64_t remaining) : state_(state), remaining_(remaining) {}
+        Value operator*() const { return {}; }
+        iterator& operator++() { --remaining_; return *this; }
+        bool operator!=(const iterator&) {
+            if (remaining_ != 0) return true;
+            state_->stop();
+            return false;
         }
+
+    private:
+        BenchState* state_;
+        std::uint64_t remaining_;
+    };
+
+    iterator begin() {
+        looped_ = true;
+        running_ = true;
+        if (counters_) counters_->enable();
+        start_ = clock::now();
+        return {this, iterations_};
     }
-    
-    out << "  </testsuite>\n</testsuites>\n";
-}
+    iterator end() { return {this, 0}; }
 
-inline bool show_help_only = false;
+    std::uint64_t iterations() const { return iterations_; }
 
-inline void parse_args(int argc, char* argv[]) {
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
-        
-        // Support both --mt_filter and --gtest_filter for compatibility
-        if (arg.starts_with("--mt_filter=")) {
-            test_filter_pattern = arg.substr(12);
-        } else if (arg.starts_with("--gtest_filter=")) {
-            test_filter_pattern = arg.substr(15);
-        } else if (arg.starts_with("--mt_output=xml:")) {
-            xml_output_path = arg.substr(16);
-        } else if (arg.starts_with("--gtest_output=xml:")) {
-            xml_output_path = arg.substr(19);
-        } else if (arg == "--mt_no_color" || arg == "--gtest_color=no") {
-            use_colors = false;
-        } else if (arg == "--mt_list_tests" || arg == "--gtest_list_tests") {
-            // List all tests in Google Test format for CMake's gtest_discover_tests
-            // Format: SuiteName.\n  TestName\n
-            std::cout << default_suite_name << ".\n";
-            for (const auto& t : get_tests()) {
-                std::cout << "  " << t.name << "\n";
-            }
-            show_help_only = true;
-        } else if (arg == "--help" || arg == "-h") {
-            std::cout << "ModernTest Options:\n"
-                      << "  --mt_filter=PATTERN      Run tests matching glob pattern\n"
-                      << "  --gtest_filter=PATTERN   (alias for --mt_filter)\n"
-                      << "  --mt_output=xml:FILE     Write JUnit XML results to FILE\n"
-                      << "  --gtest_output=xml:FILE  (alias for --mt_output)\n"
-                      << "  --mt_no_color            Disable colored output\n"
-                      << "  --gtest_color=no         (alias for --mt_no_color)\n"
-                      << "  --mt_list_tests          List all tests without running\n"
-                      << "  --gtest_list_tests       (alias for --mt_list_tests)\n"
-                      << "  --help, -h               Show this help\n";
-            show_help_only = true;
-        }
-    }
-}
-
-// --- 6. RUNNER ---
-inline int run_all_tests(int argc = 0, char* argv[] = nullptr) {
-    if (argc > 0 && argv) {
-        parse_args(argc, argv);
-        if (show_help_only) return 0;
-    }
-    
-    auto& tests = get_tests();
-    auto& results = get_results();
-    results.clear();
-    
-    // Check for ONLY
-    bool has_only = std::any_of(tests.begin(), tests.end(), 
-        [](const auto& t) { return t.status == TestStatus::ONLY; });
-
-    // Count tests that will actually run
-    int tests_to_run = 0;
-    for (const auto& t : tests) {
-        if (t.status != TestStatus::SKIP && (!has_only || t.status == TestStatus::ONLY)) {
-            if (matches_test_filters(t)) {
-                tests_to_run++;
-            }
+    // Totals for the whole run, e.g. state.iterations() * batch_size.
+    void set_items_processed(std::uint64_t items) { items_ = items; }
+    void set_bytes_processed(std::uint64_t bytes) { bytes_ = bytes; }
+
+    // Excludes per-iteration setup from the measurement.
+    void pause_timing() {
+        if (!running_) return;
+        elapsed_ += clock::now() - start_;
+        if (counters_) counters_->disable();
+        running_ = false;
+    }
+    void resume_timing() {
+        if (running_) return;
+        running_ = true;
+        if (counters_) counters_->enable();
+        start_ = clock::now();
+    }
+
+    // Counts hardware events over the same regions as the clock.
+    void count_with(detail::CounterGroup* counters) { counters_ = counters; }
+
+    bool looped() const { return looped_; }
+    double elapsed_ns() const { return std::chrono::duration<double, std::nano>(elapsed_).count(); }
+    std::uint64_t items_processed() const { return items_; }
+    std::uint64_t bytes_processed() const { return bytes_; }
+
+private:
+    void stop() { pause_timing(); }
+
+    std::uint64_t iterations_;
+    std::uint64_t items_ = 0;
+    std::uint64_t bytes_ = 0;
+    bool looped_ = false;
+    bool running_ = false;
+    detail::CounterGroup* counters_ = nullptr;
+    clock::time_point start_{};
+    clock::duration elapsed_{};
+};
+
+// --- 7. PROPERTIES ---
+// PROPERTY("name", [](int a, std::string s) { ... }) checks a body against
+// generated inputs. Each parameter type is generated by Arbitrary<T>, cases
+// are spread over worker threads in batches, and the first failing case is
+// shrunk to a minimal counterexample. Specialize Arbitrary for your own
+// types: generate(rng, size) and, optionally, shrink(value) returning
+// simpler candidates.
+
+inline std::size_t property_cases = 100;  // --mt_property_cases
+inline std::uint64_t property_seed = 0;   // --mt_property_seed, 0: random per run
+inline unsigned property_jobs = 0;        // --mt_property_jobs, 0: cores left over by --mt_jobs
+
+namespace detail {
+// Defined in the ModernTest_Runner library. Runs fn(ctx, index) for index
+// in [0, count) on `jobs` workers of its work-stealing pool; 0 jobs: the
+// cores left over by --mt_jobs.
+void run_parallel(std::size_t count, unsigned jobs, void (*fn)(void* ctx, std::size_t index), void* ctx);
+std::uint64_t fresh_property_seed();
+} // namespace detail
+
+// splitmix64: tiny state, so every case gets an independent stream from
+// (seed, case index) and batches can run in any order.
+class PropertyRng {
+public:
+    explicit PropertyRng(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t operator()() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform-enough integer in [0, bound).
+    std::uint64_t below(std::uint64_t bound) { return bound ? (*this)() % bound : 0; }
+    bool one_in(std::uint64_t n) { return below(n) == 0; }
+
+private:
+    std::uint64_t state_;
+};
+
+template <typename T, typename = void>
+struct Arbitrary {
+    static_assert(sizeof(T) == 0, "No mt::Arbitrary<T> specialization for this PROPERTY parameter type");
+};
+
+template <typename T>
+struct Arbitrary<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+    static T generate(PropertyRng& rng, std::size_t size) {
+        // Boundary values show up regularly; everything else stays near zero
+        // and grows with the case size.
+        if (rng.one_in(16)) {
+            constexpr T edges[] = {T(0), std::numeric_limits<T>::min(), std::numeric_limits<T>::max(), T(1)};
+            return edges[rng.below(4)];
+        }
+        auto span = static_cast<std::uint64_t>(size) + 1;
+        auto magnitude = static_cast<T>(rng.below(std::min<std::uint64_t>(span, std::numeric_limits<T>::max())));
+        if constexpr (std::is_signed_v<T>) {
+            if (rng.one_in(2)) return static_cast<T>(-magnitude);
+        }
+        return magnitude;
+    }
+
+    // Zero, the positive twin, then a halving search back towards the value
+    // (x - x/2, x - x/4, ..., x - 1), so a bound is found in log steps.
+    static std::vector<T> shrink(T value) {
+        std::vector<T> out;
+        if (value == 0) return out;
+        out.push_back(0);
+        if constexpr (std::is_signed_v<T>) {
+            if (value < 0 && value != std::numeric_limits<T>::min()) out.push_back(static_cast<T>(-value));
+        }
+        for (T delta = static_cast<T>(value / 2); delta != 0; delta = static_cast<T>(delta / 2)) {
+            out.push_back(static_cast<T>(value - delta));
         }
+        return out;
+    }
+};
+
+template <>
+struct Arbitrary<bool> {
+    static bool generate(PropertyRng& rng, std::size_t) { return rng.one_in(2); }
+    static std::vector<bool> shrink(bool value) { return value ? std::vector<bool>{false} : std::vector<bool>{}; }
+};
+
+template <>
+struct Arbitrary<char> {
+    static char generate(PropertyRng& rng, std::size_t) { return static_cast<char>(' ' + rng.below(95)); }
+    static std::vector<char> shrink(char value) { return value == 'a' ? std::vector<char>{} : std::vector<char>{'a'}; }
+};
+
+template <typename T>
+struct Arbitrary<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static T generate(PropertyRng& rng, std::size_t size) {
+        if (rng.one_in(16)) return T(0);
+        double unit = static_cast<double>(rng() >> 11) * 0x1.0p-53; // [0, 1)
+        double value = (unit * 2.0 - 1.0) * static_cast<double>(size + 1);
+        return static_cast<T>(value);
     }
 
-    std::cout << GREEN() << "[==========]" << RESET() 
-              << " Running " << tests_to_run << " test(s) from " << tests.size() << " registered.\n";
-    
-    auto suite_start = std::chrono::high_resolution_clock::now();
-    int passed = 0, failed = 0, skipped = 0;
-    std::vector<std::string> failed_tests;
+    static std::vector<T> shrink(T value) {
+        std::vector<T> out;
+        if (value == T(0) || !std::isfinite(value)) return out;
+        out.push_back(T(0));
+        if (std::trunc(value) != value) out.push_back(std::trunc(value));
+        if (std::abs(value) > T(1)) out.push_back(value / 2);
+        return out;
+    }
+};
+
+template <>
+struct Arbitrary<std::string> {
+    static std::string generate(PropertyRng& rng, std::size_t size) {
+        std::string s(rng.below(size + 1), ' ');
+        for (auto& c : s) c = static_cast<char>(' ' + rng.below(95)); // printable ASCII
+        return s;
+    }
 
-    for (const auto& test : tests) {
-        // Check filter
-        if (!matches_test_filters(test)) {
-            continue;
+    static std::vector<std::string> shrink(const std::string& value) {
+        std::vector<std::string> out;
+        if (value.empty()) return out;
+        out.emplace_back();
+        if (value.size() > 1) {
+            out.push_back(value.substr(0, value.size() / 2));
+            out.push_back(value.substr(value.size() / 2));
         }
-        
-        TestResult result;
-        result.name = std::string(test.name);
-        result.file = test.file;
-        result.line = test.line;
-        
-        if (test.status == TestStatus::SKIP || (has_only && test.status != TestStatus::ONLY)) {
-            skipped++;
-            result.skipped = true;
-            std::cout << YELLOW() << "[ SKIPPED  ]" << RESET() << " " << test.name << "\n";
-            results.push_back(result);
-            continue;
+        for (std::size_t i = 0; i < value.size() && i < 8; ++i) {
+            out.push_back(value.substr(0, i) + value.substr(i + 1));
+        }
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (value[i] != 'a') {
+                std::string simpler = value;
+                simpler[i] = 'a';
+                out.push_back(std::move(simpler));
+                break;
+            }
         }
+        return out;
+    }
+};
 
-        current_test_failed = false;
-        failure_messages.clear();
-        current_test_file = test.file;
-        
-        std::cout << "[ RUN      ] " << test.name << "\n";
-        
-        auto test_start = std::chrono::high_resolution_clock::now();
-        
-        try {
-            test.func();
-        } catch (const std::exception& e) {
-            std::cout << "\t" << test.file << ":" << test.line << ": " 
-                      << RED() << "error: " << RESET() 
-                      << "Unhandled exception: " << e.what() << "\n";
-            failure_messages.push_back(std::string("Unhandled exception: ") + e.what());
-            current_test_failed = true;
-        } catch (...) {
-            std::cout << "\t" << test.file << ":" << test.line << ": " 
-                      << RED() << "error: " << RESET() 
-                      << "Unknown exception thrown\n";
-            failure_messages.push_back("Unknown exception thrown");
-            current_test_failed = true;
+template <typename T>
+concept Shrinkable = requires(const T& v) { { Arbitrary<T>::shrink(v) } -> std::convertible_to<std::vector<T>>; };
+
+namespace detail {
+template <typename T>
+std::vector<T> shrink_candidates(const T& value) {
+    if constexpr (Shrinkable<T>) return Arbitrary<T>::shrink(value);
+    else return {};
+}
+} // namespace detail
+
+template <typename T>
+struct Arbitrary<std::vector<T>> {
+    static std::vector<T> generate(PropertyRng& rng, std::size_t size) {
+        std::vector<T> v;
+        auto n = rng.below(size + 1);
+        v.reserve(n);
+        for (std::uint64_t i = 0; i < n; ++i) v.push_back(Arbitrary<T>::generate(rng, size));
+        return v;
+    }
+
+    static std::vector<std::vector<T>> shrink(const std::vector<T>& value) {
+        std::vector<std::vector<T>> out;
+        if (value.empty()) return out;
+        out.emplace_back();
+        auto half = static_cast<std::ptrdiff_t>(value.size() / 2);
+        if (half > 0) {
+            out.emplace_back(value.begin(), value.begin() + half);
+            out.emplace_back(value.begin() + half, value.end());
         }
-        
-        auto test_end = std::chrono::high_resolution_clock::now();
-        double duration_ms = std::chrono::duration<double, std::milli>(test_end - test_start).count();
-        
-        result.duration_ms = duration_ms;
-        result.failures = failure_messages;
-
-        if (current_test_failed) {
-            result.passed = false;
-            std::cout << RED() << "[   FAILED ]" << RESET() 
-                      << " " << test.name 
-                      << GRAY() << " (" << static_cast<int>(duration_ms) << " ms)" << RESET() << "\n";
-            failed_tests.push_back(std::string(test.name));
-            failed++;
-        } else {
-            result.passed = true;
-            std::cout << GREEN() << "[       OK ]" << RESET() 
-                      << " " << test.name 
-                      << GRAY() << " (" << static_cast<int>(duration_ms) << " ms)" << RESET() << "\n";
-            passed++;
+        for (std::size_t i = 0; i < value.size() && i < 8; ++i) {
+            auto fewer = value;
+            fewer.erase(fewer.begin() + static_cast<std::ptrdiff_t>(i));
+            out.push_back(std::move(fewer));
         }
-        
-        results.push_back(result);
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            auto simpler = detail::shrink_candidates(value[i]);
+            if (simpler.empty()) continue;
+            auto copy = value;
+            copy[i] = std::move(simpler.front());
+            out.push_back(std::move(copy));
+            break;
+        }
+        return out;
+    }
+};
+
+template <typename T>
+struct Arbitrary<std::optional<T>> {
+    static std::optional<T> generate(PropertyRng& rng, std::size_t size) {
+        if (rng.one_in(8)) return std::nullopt;
+        return Arbitrary<T>::generate(rng, size);
+    }
+
+    static std::vector<std::optional<T>> shrink(const std::optional<T>& value) {
+        std::vector<std::optional<T>> out;
+        if (!value) return out;
+        out.emplace_back(std::nullopt);
+        for (auto& v : detail::shrink_candidates(*value)) out.emplace_back(std::move(v));
+        return out;
+    }
+};
+
+template <typename A, typename B>
+struct Arbitrary<std::pair<A, B>> {
+    static std::pair<A, B> generate(PropertyRng& rng, std::size_t size) {
+        A a = Arbitrary<A>::generate(rng, size);
+        return {std::move(a), Arbitrary<B>::generate(rng, size)};
+    }
+
+    static std::vector<std::pair<A, B>> shrink(const std::pair<A, B>& value) {
+        std::vector<std::pair<A, B>> out;
+        for (auto& a : detail::shrink_candidates(value.first)) out.emplace_back(std::move(a), value.second);
+        for (auto& b : detail::shrink_candidates(value.second)) out.emplace_back(value.first, std::move(b));
+        return out;
+    }
+};
+
+namespace detail {
+// Parameter types of a property body, the same way Mock<Ret(Args...)>
+// takes its signature apart.
+template <typename Sig>
+struct property_signature;
+
+template <typename C, typename R, typename... Args>
+struct property_signature<R (C::*)(Args...) const> {
+    using result = R;
+    using args = std::tuple<std::decay_t<Args>...>;
+};
+
+template <typename C, typename R, typename... Args>
+struct property_signature<R (C::*)(Args...)> : property_signature<R (C::*)(Args...) const> {};
+
+template <typename F>
+using property_args = typename property_signature<decltype(&F::operator())>::args;
+
+template <typename T>
+void describe_value(std::ostream& os, const T& value) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        os << '"' << value << '"';
+    } else if constexpr (std::is_same_v<T, char>) {
+        os << '\'' << value << '\'';
+    } else if constexpr (std::is_same_v<T, bool>) {
+        os << (value ? "true" : "false");
+    } else if constexpr (requires { value.has_value(); *value; }) {
+        if (value) describe_value(os, *value);
+        else os << "nullopt";
+    } else if constexpr (requires { value.first; value.second; }) {
+        os << '{';
+        describe_value(os, value.first);
+        os << ", ";
+        describe_value(os, value.second);
+        os << '}';
+    } else if constexpr (range<T>) {
+        os << '[';
+        bool first = true;
+        for (const auto& e : value) {
+            os << (first ? "" : ", ");
+            describe_value(os, e);
+            first = false;
+        }
+        os << ']';
+    } else if constexpr (requires { os << value; }) {
+        os << value;
+    } else {
+        os << "<unprintable>";
+    }
+}
+
+template <typename Tuple>
+std::string describe_args(const Tuple& args) {
+    MessageStream os;
+    os << '(';
+    std::apply([&](const auto&... a) {
+        std::size_t i = 0;
+        ((os << (i++ ? ", " : ""), describe_value(os, a)), ...);
+    }, args);
+    os << ')';
+    return os.str();
+}
+
+// Runs one case against a scratch context; on failure `why` gets the first
+// recorded message.
+template <typename F, typename Tuple>
+bool property_holds(const F& body, const Tuple& args, std::string* why = nullptr) {
+    TestContext ctx;
+    ContextScope scope(ctx);
+    Tuple copy = args;
+    bool held = true;
+    try {
+        if constexpr (std::is_same_v<decltype(std::apply(body, copy)), bool>) held = std::apply(body, copy);
+        else std::apply(body, copy);
+    } catch (const std::exception& e) {
+        held = false;
+        if (why) *why = std::string("Unhandled exception: ") + e.what();
+    } catch (...) {
+        held = false;
+        if (why) *why = "Unknown exception thrown";
+    }
+    if (ctx.failed) {
+        held = false;
+        if (why && !ctx.failures.empty()) *why = ctx.failures.front().message;
+    } else if (!held && why && why->empty()) {
+        *why = "Property returned false";
     }
+    return held;
+}
+
+template <typename Tuple>
+Tuple generate_args(std::uint64_t seed, std::size_t index, std::size_t cases) {
+    PropertyRng rng(seed ^ (0xD1B54A32D192ED03ull * (index + 1)));
+    // Small inputs first: the size bound grows from 0 to 100 over the run.
+    std::size_t size = cases > 1 ? index * 100 / (cases - 1) : 100;
+    return [&]<std::size_t... I>(std::index_sequence<I...>) {
+        return Tuple{Arbitrary<std::tuple_element_t<I, Tuple>>::generate(rng, size)...};
+    }(std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+}
+
+// Greedy shrinking: take the first simpler candidate for any argument that
+// still fails, and start over from it.
+template <typename F, typename Tuple>
+std::size_t shrink_args(const F& body, Tuple& args, std::string& why) {
+    constexpr std::size_t max_steps = 1000;
+    std::size_t steps = 0;
+    bool progressed = true;
+    while (progressed && steps < max_steps) {
+        progressed = false;
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            ([&] {
+                if (progressed) return;
+                for (auto&& candidate : shrink_candidates(std::get<I>(args))) {
+                    Tuple trial = args;
+                    std::get<I>(trial) = std::move(candidate);
+                    std::string trial_why;
+                    if (!property_holds(body, trial, &trial_why)) {
+                        args = std::move(trial);
+                        why = std::move(trial_why);
+                        progressed = true;
+                        steps++;
+                        return;
+                    }
+                }
+            }(), ...);
+        }(std::make_index_sequence<std::tuple_size_v<Tuple>>{});
+    }
+    return steps;
+}
+
+} // namespace detail
+
+// Per-property case count: PROPERTY("name", body, mt::cases{1000})
+struct cases {
+    std::size_t count;
+};
+
+// The body of a PROPERTY test. Options that belong to the node (timeout)
+// are handed to it by Registrar through configure().
+template <typename F, typename... Options>
+class Property {
+public:
+    explicit Property(F body, Options... options) : body_(std::move(body)), options_(std::move(options)...) {}
+
+    void configure(TestCase& node) {
+        file_ = node.file;
+        line_ = node.line;
+        std::apply([&](const auto&... o) { (configure_one(node, o), ...); }, options_);
+    }
+
+    void operator()() const {
+        using Args = detail::property_args<F>;
+        const std::size_t count = cases_ ? cases_ : property_cases;
+        const std::uint64_t seed = property_seed ? property_seed : detail::fresh_property_seed();
+
+        // Batches of cases run on property_jobs threads; the lowest failing
+        // index wins so the reported counterexample does not depend on
+        // scheduling.
+        constexpr std::size_t batch = 16;
+        std::atomic<std::size_t> first_failure{count};
+        std::size_t batches = (count + batch - 1) / batch;
+        auto run_batch = [&](std::size_t b) {
+            for (std::size_t i = b * batch; i < std::min(count, (b + 1) * batch); ++i) {
+                if (i >= first_failure.load(std::memory_order_relaxed)) return;
+                if (!detail::property_holds(body_, detail::generate_args<Args>(seed, i, count))) {
+                    std::size_t seen = first_failure.load(std::memory_order_relaxed);
+                    while (i < seen && !first_failure.compare_exchange_weak(seen, i)) {}
+                    return;
+                }
+            }
+        };
+        detail::run_parallel(batches, property_jobs, [](void* ctx, std::size_t b) {
+            (*static_cast<decltype(run_batch)*>(ctx))(b);
+        }, &run_batch);
+
+        std::size_t failed_at = first_failure.load();
+        if (failed_at == count) return;
 
-    auto suite_end = std::chrono::high_resolution_clock::now();
-    double total_ms = std::chrono::duration<double, std::milli>(suite_end - suite_start).count();
+        Args args = detail::generate_args<Args>(seed, failed_at, count);
+        std::string why;
+        detail::property_holds(body_, args, &why);
+        std::string original = detail::describe_args(args);
+        std::size_t steps = detail::shrink_args(body_, args, why);
 
-    std::cout << GREEN() << "[==========]" << RESET() 
-              << " " << (passed + failed) << " test(s) ran. "
-              << GRAY() << "(" << static_cast<int>(total_ms) << " ms total)" << RESET() << "\n";
-    
-    if (passed > 0) {
-        std::cout << GREEN() << "[  PASSED  ]" << RESET() << " " << passed << " test(s).\n";
+        detail::MessageStream msg;
+        msg << "Property falsified after " << failed_at + 1 << " case(s) (seed " << seed
+            << "; replay with --mt_property_seed=" << seed << ")\n"
+            << "\t  counterexample: " << detail::describe_args(args);
+        if (steps > 0) msg << " (shrunk in " << steps << " step(s) from " << original << ")";
+        msg << "\n\t  failure: " << why;
+        detail::record_failure(file_, line_, msg.str());
     }
-    if (skipped > 0) {
-        std::cout << YELLOW() << "[ SKIPPED  ]" << RESET() << " " << skipped << " test(s).\n";
+
+private:
+    template <typename O>
+    void configure_one(TestCase& node, const O& option) {
+        if constexpr (std::is_same_v<O, cases>) cases_ = option.count;
+        else detail::apply_option(node, option);
+    }
+
+    F body_;
+    std::tuple<Options...> options_;
+    std::size_t cases_ = 0;
+    const char* file_ = "";
+    int line_ = 0;
+};
+
+// --- 8. ASYNC ---
+// TEST_ASYNC bodies are coroutines returning mt::task<>. The runner drives
+// all of them on one thread with an event loop, resuming whichever test's
+// timer or event is due, so tests that wait overlap their waits:
+//   TEST_ASYNC("Reconnects", []() -> mt::task<> {
+//       co_await mt::sleep_for(std::chrono::milliseconds{50});
+//       expect(co_await client.reconnect()) == true;
+//   });
+// The loop lives in the runner library; this part only suspends and
+// re-queues coroutines.
+namespace detail {
+class EventLoop;
+inline thread_local EventLoop* active_loop = nullptr; // set while a loop runs on this thread
+
+// Defined in the ModernTest_Runner library. schedule_at() queues a
+// resumption on the loop's own thread; post() may be called from any
+// thread. `test` is the context bound while the coroutine runs.
+void schedule_at(EventLoop& loop, std::coroutine_handle<> handle, TestContext* test,
+                 std::chrono::steady_clock::time_point when);
+void post(EventLoop& loop, std::coroutine_handle<> handle, TestContext* test);
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> self) noexcept {
+            return self.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+    void return_value(T v) { value.emplace(std::move(v)); }
+    T result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    void return_void() {}
+    void result() {
+        if (error) std::rethrow_exception(error);
     }
-    if (failed > 0) {
-        std::cout << RED() << "[  FAILED  ]" << RESET() << " " << failed << " test(s):\n";
-        for (const auto& name : failed_tests) {
-            std::cout << RED() << "             " << name << RESET() << "\n";
+};
+} // namespace detail
+
+// A lazily started coroutine. co_await runs it to completion and yields its
+// result (or rethrows its exception); the awaiting coroutine resumes on the
+// same thread the moment it finishes.
+template <typename T = void>
+class [[nodiscard]] task {
+public:
+    struct promise_type : detail::TaskPromise<T> {
+        task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    };
+
+    task() = default;
+    task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
         }
+        return *this;
     }
+    ~task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume() { return handle_.promise().result(); }
+
+    std::coroutine_handle<promise_type> handle() const noexcept { return handle_; }
 
-    // Write JUnit XML if requested
-    if (!xml_output_path.empty()) {
-        write_junit_xml(xml_output_path, total_ms);
-        std::cout << GRAY() << "[   INFO   ] XML results written to: " << xml_output_path << RESET() << "\n";
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+inline task<void> TestCase::run_async() const { return invoke_async(target, case_number); }
+
+namespace detail {
+struct TimerAwaiter {
+    std::chrono::steady_clock::time_point when;
+
+    // Without a loop on this thread (a plain TEST awaiting a helper) the
+    // wait simply blocks.
+    bool await_ready() const {
+        if (active_loop) return false;
+        block_until(when);
+        return true;
     }
+    void await_suspend(std::coroutine_handle<> handle) const { schedule_at(*active_loop, handle, active_context, when); }
+    void await_resume() const noexcept {}
+};
+} // namespace detail
 
-    return failed > 0 ? 1 : 0;
+// Suspends the calling test; other tests run until the time is up.
+template <typename Rep, typename Period>
+detail::TimerAwaiter sleep_for(std::chrono::duration<Rep, Period> d) {
+    return {std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(d)};
 }
+inline detail::TimerAwaiter sleep_until(std::chrono::steady_clock::time_point when) { return {when}; }
+// Lets every other ready test run before continuing.
+inline detail::TimerAwaiter yield() { return {std::chrono::steady_clock::time_point{}}; }
+
+// A one-shot signal for handing results from other threads (I/O callbacks,
+// workers) to an async test: set() wakes every coroutine awaiting it.
+class async_event {
+    struct Waiter {
+        async_event* event;
+        detail::EventLoop* loop = nullptr;
+        std::coroutine_handle<> handle;
+        TestContext* test = nullptr;
+        Waiter* next = nullptr;
+        bool linked = false;
+
+        explicit Waiter(async_event* e) : event(e) {}
+        Waiter(const Waiter&) = delete;
+        Waiter& operator=(const Waiter&) = delete;
+        // Also runs when a timed-out test's frame is destroyed mid-wait.
+        ~Waiter() {
+            detail::LockGuard lock(event->mutex_);
+            if (!linked) return;
+            for (Waiter** p = &event->waiters_; *p; p = &(*p)->next) {
+                if (*p == this) {
+                    *p = next;
+                    break;
+                }
+            }
+        }
+
+        // Without a loop on this thread the wait simply blocks.
+        bool await_ready() {
+            if (!detail::active_loop) event->set_.wait(false, std::memory_order_acquire);
+            return event->set_.load(std::memory_order_acquire);
+        }
+        bool await_suspend(std::coroutine_handle<> h) {
+            detail::LockGuard lock(event->mutex_);
+            if (event->set_.load(std::memory_order_relaxed)) return false;
+            loop = detail::active_loop;
+            handle = h;
+            test = detail::active_context;
+            next = event->waiters_;
+            event->waiters_ = this;
+            linked = true;
+            return true;
+        }
+        void await_resume() const noexcept {}
+    };
+
+public:
+    async_event() = default;
+    async_event(const async_event&) = delete;
+    async_event& operator=(const async_event&) = delete;
+
+    void set() {
+        {
+            detail::LockGuard lock(mutex_);
+            set_.store(true, std::memory_order_release);
+            for (Waiter* w = std::exchange(waiters_, nullptr); w;) {
+                Waiter* next = w->next;
+                w->linked = false;
+                detail::post(*w->loop, w->handle, w->test);
+                w = next;
+            }
+        }
+        set_.notify_all();
+    }
+    bool is_set() const { return set_.load(std::memory_order_acquire); }
+    void reset() { set_.store(false, std::memory_order_release); }
+
+    Waiter operator co_await() { return Waiter(this); }
+
+private:
+    detail::Lock mutex_; // guards waiters_
+    std::atomic<bool> set_{false};
+    Waiter* waiters_ = nullptr;
+};
+
+// --- 9. RUNNER ---
+// Defined in the ModernTest_Runner library. Parses the command line and the environment, runs the selected tests and
+// returns the process exit code.
+int run_all_tests(int argc = 0, char* argv[] = nullptr);
 
 } // namespace mt
 
-// --- 6. MACROS ---
+// --- 10. MACROS ---
 #define MT_CONCAT_IMPL(x, y) x##y
 #define MT_CONCAT(x, y) MT_CONCAT_IMPL(x, y)
 
-#define TEST(name, ...) static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(name, __VA_ARGS__, mt::TestStatus::NORMAL)
-#define TEST_SKIP(name, ...) static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(name, __VA_ARGS__, mt::TestStatus::SKIP)
-#define TEST_ONLY(name, ...) static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(name, __VA_ARGS__, mt::TestStatus::ONLY)
\ No newline at end of file
+#define TEST(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::NORMAL, std::source_location::current(), name, __VA_ARGS__)
+#define TEST_SKIP(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::SKIP, std::source_location::current(), name, __VA_ARGS__)
+#define TEST_ONLY(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::ONLY, std::source_location::current(), name, __VA_ARGS__)
+#define PROPERTY(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::NORMAL, std::source_location::current(), name, mt::Property(__VA_ARGS__))
+#define TEST_CASES(name, ...) \
+    static mt::CaseRegistrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::NORMAL, std::source_location::current(), name, __VA_ARGS__)
+#define TEST_ASYNC(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::NORMAL, std::source_location::current(), name, __VA_ARGS__)
+#define BENCH(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::NORMAL, std::source_location::current(), name, __VA_ARGS__)
+#define BENCH_SKIP(name, ...) \
+    static mt::Registrar MT_CONCAT(_reg_, __COUNTER__)(mt::TestStatus::SKIP, std::source_location::current(), name, __VA_ARGS__)
@@ -0,0 +1,1334 @@
+#pragma once
+
+// Runner internals shared by the ModernTest_Runner library and the
+// framework's own tests: flags, filters, scheduling, the wire format of
+// isolated runs. Test translation units only need ModernTest.hpp.
+#include "ModernTest.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <stop_token>
+#include <thread>
+#include <unordered_map>
+
+namespace mt {
+
+// --- 1. GLOBALS & COLORS ---
+inline bool use_colors = true;
+inline constexpr std::string_view default_suite_name = "ModernTest";
+
+namespace color {
+inline constexpr std::string_view green  = "\033[32m";
+inline constexpr std::string_view red    = "\033[31m";
+inline constexpr std::string_view yellow = "\033[33m";
+inline constexpr std::string_view gray   = "\033[90m";
+inline constexpr std::string_view bold   = "\033[1m";
+inline constexpr std::string_view reset  = "\033[0m";
+}
+
+inline std::string_view GREEN() { return use_colors ? color::green : std::string_view{}; }
+inline std::string_view RED()   { return use_colors ? color::red : std::string_view{}; }
+inline std::string_view YELLOW(){ return use_colors ? color::yellow : std::string_view{}; }
+inline std::string_view GRAY()  { return use_colors ? color::gray : std::string_view{}; }
+inline std::string_view BOLD()  { return use_colors ? color::bold : std::string_view{}; }
+inline std::string_view RESET() { return use_colors ? color::reset : std::string_view{}; }
+
+inline std::vector<TestResult>& get_results() {
+    static std::vector<TestResult> results;
+    return results;
+}
+
+// Filter pattern for --mt_filter or --gtest_filter
+inline std::string test_filter_pattern;
+inline std::string xml_output_path;
+
+// Fires together with cancellation_requested(), for tests that would
+// rather wait than poll: a std::condition_variable_any wait or a
+// std::stop_callback ends when the run is cut short.
+namespace detail {
+inline std::stop_source cancel_source;
+}
+
+inline std::stop_token cancellation_token() { return detail::cancel_source.get_token(); }
+
+// --- 2. INSTRUMENTATION ---
+// Point-in-time resource readings. CPU times are for the calling thread
+// where the platform allows it; peak RSS is the process high-water mark.
+struct ResourceSample {
+    double user_cpu_ms = 0.0;
+    double system_cpu_ms = 0.0;
+    std::uint64_t peak_rss_kb = 0;
+};
+
+namespace detail {
+// Portable fallback: process CPU time, no user/system split, no RSS.
+inline ResourceSample sample_resources_portably() {
+    ResourceSample s;
+    s.user_cpu_ms = 1000.0 * static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+    return s;
+}
+
+// Replaced at static initialization by the runner library with a
+// platform-specific sampler (getrusage, GetThreadTimes, ...).
+inline ResourceSample (*sample_resources)() = &sample_resources_portably;
+} // namespace detail
+
+// Per-test instrumentation (--mt_instrument).
+inline bool instrument_enabled = false;
+inline int instrument_top = 5;
+
+// Hardware counters for benchmarks and instrumented tests
+// (--mt_perf_counters / MT_PERF_COUNTERS). Cleared with a warning when the
+// platform refuses them.
+inline bool perf_counters_enabled = false;
+
+namespace detail {
+// Cycles, instructions, L1d read misses, LLC misses and branch misses of
+// the calling thread, user space only, opened as one perf_event group so
+// they are scheduled together. Counters that fail to open are left out;
+// without perf_event_open (macOS, Windows, seccomp) the group is empty.
+// Defined in ModernTestInstrument.cpp.
+class PerfCounterGroup final : public CounterGroup {
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool available() const { return leader_ >= 0; }
+    // Why nothing could be opened, e.g. "perf_event_open: Permission denied".
+    const std::string& error() const { return error_; }
+
+    void enable() override;
+    void disable() override;
+    void reset();
+    // Totals since the last reset(), scaled up if the kernel multiplexed
+    // the group with other events.
+    PerfCounters read() const;
+
+private:
+    std::array<int, 5> fds_{-1, -1, -1, -1, -1};
+    int leader_ = -1;
+    std::string error_;
+};
+} // namespace detail
+
+// PerfCounters' fields under the names reports and baselines use.
+inline constexpr std::pair<std::string_view, std::optional<double> PerfCounters::*> perf_counter_fields[] = {
+    {"cycles", &PerfCounters::cycles},
+    {"instructions", &PerfCounters::instructions},
+    {"l1d_misses", &PerfCounters::l1d_misses},
+    {"llc_misses", &PerfCounters::llc_misses},
+    {"branch_misses", &PerfCounters::branch_misses},
+};
+
+inline PerfCounters scale_counters(const PerfCounters& c, double factor) {
+    auto scaled = [&](const std::optional<double>& v) { return v ? std::optional(*v * factor) : std::nullopt; };
+    return {scaled(c.cycles), scaled(c.instructions), scaled(c.l1d_misses), scaled(c.llc_misses), scaled(c.branch_misses)};
+}
+
+// "1.23k cycles  2.84k instructions  IPC 2.31  L1d miss 12.3  ..."
+inline std::string format_counters(const PerfCounters& c) {
+    std::ostringstream oss;
+    oss.precision(3);
+    const char* sep = "";
+    auto field = [&](const std::optional<double>& v, std::string_view label, bool label_first) {
+        if (!v) return;
+        double x = *v;
+        std::string_view suffix;
+        if (x >= 1e9) { x /= 1e9; suffix = "G"; }
+        else if (x >= 1e6) { x /= 1e6; suffix = "M"; }
+        else if (x >= 1e3) { x /= 1e3; suffix = "k"; }
+        oss << sep;
+        if (label_first) oss << label << " ";
+        oss << x << suffix;
+        if (!label_first) oss << " " << label;
+        sep = "  ";
+    };
+    field(c.cycles, "cycles", false);
+    field(c.instructions, "instructions", false);
+    field(c.ipc(), "IPC", true);
+    field(c.l1d_misses, "L1d miss", true);
+    field(c.llc_misses, "LLC miss", true);
+    field(c.branch_misses, "branch miss", true);
+    return oss.str();
+}
+
+// Measures one test on the calling thread. Allocations and CPU time made by
+// threads the test spawns are not attributed to it, and the RSS delta is
+// the growth of the process-wide peak, so it is only exact in serial runs.
+class ResourceProbe {
+public:
+    ResourceProbe() : start_(detail::sample_resources()), allocs_(detail::alloc_counters) {
+        if (perf_counters_enabled) {
+            counters_.emplace();
+            counters_->enable();
+        }
+    }
+
+    ResourceUsage finish() const {
+        if (counters_) counters_->disable();
+        ResourceSample end = detail::sample_resources();
+        const AllocCounters& now = detail::alloc_counters;
+        ResourceUsage u;
+        u.user_cpu_ms = end.user_cpu_ms - start_.user_cpu_ms;
+        u.system_cpu_ms = end.system_cpu_ms - start_.system_cpu_ms;
+        u.allocations = now.count - allocs_.count;
+        u.allocated_bytes = now.bytes - allocs_.bytes;
+        u.peak_rss_delta_kb = end.peak_rss_kb > start_.peak_rss_kb ? end.peak_rss_kb - start_.peak_rss_kb : 0;
+        if (counters_ && counters_->available()) u.counters = counters_->read();
+        return u;
+    }
+
+private:
+    ResourceSample start_;
+    AllocCounters allocs_;
+    mutable std::optional<detail::PerfCounterGroup> counters_;
+};
+
+// Run timeline (--mt_trace / MT_TRACE), written as Chrome trace-event JSON
+// for chrome://tracing and ui.perfetto.dev. Events are buffered per thread
+// and collected once the run is over.
+inline std::string trace_output_path;
+
+struct TraceEvent {
+    std::string name;
+    std::string category;
+    std::string args;      // JSON object members, e.g. "\"passed\": false"
+    double ts_us = 0.0;    // since start_trace()
+    double value = 0.0;    // duration in microseconds, or a counter's reading
+    std::uint32_t track = 0;
+    bool counter = false;
+};
+
+namespace detail {
+// The calling thread's track. The runner numbers its workers from 1;
+// other threads get a track of their own on their first event.
+inline thread_local std::uint32_t trace_track = 0;
+inline constexpr std::uint32_t first_thread_track = 10000;
+
+void start_trace();
+void stop_trace(); // keeps what was recorded
+bool tracing();
+void name_trace_track(std::uint32_t track, std::string name);
+// Track 0 is the calling thread's.
+void record_trace_span(std::string_view name, std::string_view category, TraceClock::time_point start,
+                       TraceClock::time_point end, std::uint32_t track = 0, std::string args = {});
+std::vector<TraceEvent> collect_trace(); // ordered by timestamp
+std::map<std::uint32_t, std::string> trace_track_names();
+} // namespace detail
+
+std::string format_trace(const std::vector<TraceEvent>& events, const std::map<std::uint32_t, std::string>& tracks);
+bool write_trace(const std::string& path);
+
+// --- 3. BENCHMARKS ---
+// Measurement knobs (--mt_bench*). Without --mt_bench every BENCH runs a
+// single iteration, so test runs and ctest only smoke-test the bodies.
+inline bool bench_enabled = false;
+inline double bench_min_time_ms = 100.0;
+inline double bench_warmup_ms = 50.0;
+inline int bench_repetitions = 5;
+
+inline void summarize(BenchResult& r) {
+    auto& s = r.samples_ns;
+    if (s.empty()) return;
+    std::vector<double> sorted = s;
+    std::sort(sorted.begin(), sorted.end());
+    std::size_t n = sorted.size();
+    r.min_ns = sorted.front();
+    r.median_ns = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    r.mean_ns = std::accumulate(s.begin(), s.end(), 0.0) / static_cast<double>(n);
+    double sq = 0.0;
+    for (double x : s) sq += (x - r.mean_ns) * (x - r.mean_ns);
+    r.stddev_ns = n > 1 ? std::sqrt(sq / static_cast<double>(n - 1)) : 0.0;
+}
+
+// "12.3 ns", "4.56 us", ...
+inline std::string format_ns(double ns) {
+    static constexpr std::string_view units[] = {"ns", "us", "ms", "s"};
+    std::size_t u = 0;
+    while (ns >= 1000.0 && u + 1 < std::size(units)) {
+        ns /= 1000.0;
+        ++u;
+    }
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << ns << " " << units[u];
+    return oss.str();
+}
+
+// "81.2M items/s"
+inline std::string format_rate(double per_second, std::string_view unit) {
+    static constexpr std::string_view scale[] = {"", "k", "M", "G", "T"};
+    std::size_t u = 0;
+    while (per_second >= 1000.0 && u + 1 < std::size(scale)) {
+        per_second /= 1000.0;
+        ++u;
+    }
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << per_second << scale[u] << " " << unit << "/s";
+    return oss.str();
+}
+
+// Runs one BENCH body: warmup, calibration of the iteration count so that a
+// repetition lasts at least bench_min_time_ms, then bench_repetitions timed
+// repetitions. Returns nothing in smoke mode or once an assertion fails.
+std::optional<BenchResult> measure_benchmark(const TestCase& test);
+
+inline std::string format_bench(const BenchResult& r) {
+    std::string line = format_ns(r.mean_ns) + "/iter  median " + format_ns(r.median_ns)
+                     + "  stddev " + format_ns(r.stddev_ns) + "  min " + format_ns(r.min_ns)
+                     + "  (" + std::to_string(r.samples_ns.size()) + " x " + std::to_string(r.iterations) + " iters)";
+    if (r.items_per_second > 0.0) line += "  " + format_rate(r.items_per_second, "items");
+    if (r.bytes_per_second > 0.0) line += "  " + format_rate(r.bytes_per_second, "B");
+    return line;
+}
+
+// Baselines (--mt_bench_out / --mt_bench_compare). File format: a
+// "# moderntest-bench v2" header followed by one
+// "<iterations>\t<ns/iter per repetition, comma separated>\t<counters>\t<name>"
+// line per benchmark, where <counters> is "cycles=12.5,instructions=40.2,..."
+// per iteration or "-". v1 files have no <counters> column.
+inline std::string bench_out_path;
+inline std::string bench_compare_path;
+inline double bench_threshold_pct = 5.0;
+inline double bench_alpha = 0.05;
+
+using BenchBaseline = std::unordered_map<std::string, BenchResult>;
+inline BenchBaseline bench_baseline;
+
+BenchBaseline load_bench_baseline(const std::string& path);
+bool save_bench_baseline(const std::string& path, const std::vector<TestResult>& results);
+
+// One-sided Mann-Whitney U test: probability of seeing samples this much
+// slower than the baseline if both came from the same distribution.
+// Normal approximation with tie and continuity correction.
+inline double mann_whitney_p_slower(const std::vector<double>& current, const std::vector<double>& baseline) {
+    const std::size_t n1 = current.size(), n2 = baseline.size(), n = n1 + n2;
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    std::vector<std::pair<double, bool>> all; // (value, is_current)
+    all.reserve(n);
+    for (double x : current) all.emplace_back(x, true);
+    for (double x : baseline) all.emplace_back(x, false);
+    std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    double rank_sum = 0.0, tie_term = 0.0;
+    for (std::size_t i = 0; i < n; ) {
+        std::size_t j = i;
+        while (j < n && all[j].first == all[i].first) ++j;
+        double rank = (static_cast<double>(i + j) + 1.0) / 2.0; // average of ranks i+1..j
+        for (std::size_t k = i; k < j; ++k) {
+            if (all[k].second) rank_sum += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+
+    double u = rank_sum - static_cast<double>(n1 * (n1 + 1)) / 2.0;
+    double mean = static_cast<double>(n1 * n2) / 2.0;
+    double dn = static_cast<double>(n);
+    double var = static_cast<double>(n1 * n2) / 12.0 * ((dn + 1.0) - tie_term / (dn * (dn - 1.0)));
+    if (var <= 0.0) return 1.0;
+    double z = (u - mean - 0.5) / std::sqrt(var);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+// A regression is a median slowdown past the threshold that the U test also
+// considers significant. With fewer than 3 repetitions on either side the
+// test has no power, so the threshold alone decides.
+inline BenchComparison compare_bench(const BenchResult& current, const BenchResult& baseline) {
+    BenchComparison c;
+    if (baseline.median_ns <= 0.0) return c;
+    c.change_pct = (current.median_ns - baseline.median_ns) / baseline.median_ns * 100.0;
+    c.p_value = mann_whitney_p_slower(current.samples_ns, baseline.samples_ns);
+    bool testable = current.samples_ns.size() >= 3 && baseline.samples_ns.size() >= 3;
+    c.regressed = c.change_pct > bench_threshold_pct && (!testable || c.p_value < bench_alpha);
+    return c;
+}
+
+inline std::string format_comparison(const BenchComparison& c) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << (c.change_pct >= 0 ? "+" : "") << c.change_pct
+        << "% median vs baseline (p=" << std::setprecision(3) << c.p_value << ")";
+    return oss.str();
+}
+
+// --- 4. UTILITIES ---
+// Appends without building temporaries; used by the listing and the reporters.
+template <typename... Parts>
+void append(std::string& out, const Parts&... parts) {
+    (out.append(std::string_view(parts)), ...);
+}
+
+inline void append_number(std::string& out, long long value) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, end);
+}
+
+inline void append_fixed(std::string& out, double value, int precision) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+    out.append(buf, ec == std::errc() ? end : buf);
+}
+
+// Case-insensitive glob matching: '*' matches any run of characters, '?'
+// any single one. The subject is the concatenation of up to three segments
+// so "ModernTest." + name + "/<case>" can be matched without building it.
+// Either end can be left open, as if the pattern began or ended with '*';
+// glob_search leaves both open.
+// Greedy with single-star backtracking: no allocation, and linear in the
+// subject unless the pattern contains several competing stars.
+struct NameView {
+    std::string_view head;
+    std::string_view mid;
+    std::string_view tail;
+
+    std::size_t size() const { return head.size() + mid.size() + tail.size(); }
+    char operator[](std::size_t i) const {
+        if (i < head.size()) return head[i];
+        i -= head.size();
+        return i < mid.size() ? mid[i] : tail[i - mid.size()];
+    }
+};
+
+inline char fold_case(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+inline bool glob_match(std::string_view pattern, NameView subject, bool open_start, bool open_end) {
+    std::size_t p = 0, i = 0, n = subject.size();
+    bool starred = open_start;
+    std::size_t star = 0, mark = 0;
+    while (i < n) {
+        bool more = p < pattern.size();
+        if (!more && open_end) return true;
+        if (more && pattern[p] == '*') {
+            starred = true;
+            star = ++p;
+            mark = i;
+        } else if (more && (pattern[p] == '?' || fold_case(pattern[p]) == fold_case(subject[i]))) {
+            ++p;
+            ++i;
+        } else if (starred) {
+            p = star;
+            i = ++mark;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+inline bool glob_search(std::string_view pattern, NameView subject) {
+    return glob_match(pattern, subject, true, true);
+}
+
+inline bool matches_filter(std::string_view name, std::string_view pattern) {
+    return pattern.empty() || glob_search(pattern, {name, {}, {}});
+}
+
+// A --gtest_filter expression compiled once: "POS1:POS2-NEG1:NEG2".
+// A test runs when it matches any positive pattern (all tests when there
+// are none) and no negative one. A pattern that starts with "ModernTest."
+// is a gtest name, the form gtest_discover_tests passes, and must match the
+// whole of "ModernTest.<name>/<case>"; any other pattern is searched for in
+// the bare name. A pattern ending in "/<digits>" names one case, so
+// "Squares/1" never selects "Squares/12". An expression that is a gtest name
+// without wildcards is not split at all: it is the exact name of one test,
+// which may itself contain '-' or ':'.
+class TestFilter {
+public:
+    TestFilter() = default;
+    explicit TestFilter(std::string expression) { compile(std::move(expression)); }
+
+    void compile(std::string expression) {
+        source_ = std::move(expression);
+        positive_.clear();
+        negative_.clear();
+        cache_.clear();
+
+        std::string_view src = source_;
+        if (is_gtest_name(src) && src.find_first_of("*?") == std::string_view::npos) {
+            positive_.push_back({0, src.size()});
+            return;
+        }
+        std::size_t dash = src.find('-');
+        split(0, std::min(dash, src.size()), positive_);
+        if (dash != std::string_view::npos) split(dash + 1, src.size(), negative_);
+    }
+
+    const std::string& source() const { return source_; }
+    bool empty() const { return positive_.empty() && negative_.empty(); }
+
+    // `suffix` is the "/<case>" part of a TEST_CASES entry, if any.
+    bool matches(std::string_view name, std::string_view suffix = {}) const {
+        if (empty()) return true;
+        if (!positive_.empty() && !any_of(positive_, name, suffix)) return false;
+        return !any_of(negative_, name, suffix);
+    }
+
+    // Cached by registration index: the runner asks about every test more
+    // than once per run and the answer never changes. Not thread-safe.
+    bool matches(const TestCase& test) const {
+        if (test.index >= cache_.size()) cache_.resize(std::max(test.index + 1, get_tests().size()), UNKNOWN);
+        auto& slot = cache_[test.index];
+        if (slot == UNKNOWN) slot = matches(test.name, detail::CaseSuffix(test).view()) ? MATCH : NO_MATCH;
+        return slot == MATCH;
+    }
+
+private:
+    struct Span { std::size_t pos, len; };
+    enum : signed char { UNKNOWN = -1, NO_MATCH = 0, MATCH = 1 };
+
+    void split(std::size_t from, std::size_t to, std::vector<Span>& out) {
+        while (from <= to) {
+            std::size_t colon = std::min(source_.find(':', from), to);
+            if (colon > from) out.push_back({from, colon - from});
+            from = colon + 1;
+        }
+    }
+
+    static constexpr std::string_view gtest_prefix = "ModernTest.";
+    static_assert(gtest_prefix.substr(0, gtest_prefix.size() - 1) == default_suite_name);
+
+    static bool is_gtest_name(std::string_view pattern) {
+        return pattern.size() >= gtest_prefix.size() &&
+               std::equal(gtest_prefix.begin(), gtest_prefix.end(), pattern.begin(),
+                          [](char a, char b) { return fold_case(a) == fold_case(b); });
+    }
+
+    static bool names_case(std::string_view pattern) {
+        std::size_t slash = pattern.rfind('/');
+        if (slash == std::string_view::npos || slash + 1 == pattern.size()) return false;
+        return std::all_of(pattern.begin() + static_cast<std::ptrdiff_t>(slash) + 1, pattern.end(),
+                           [](char c) { return c >= '0' && c <= '9'; });
+    }
+
+    bool any_of(const std::vector<Span>& patterns, std::string_view name, std::string_view suffix) const {
+        for (const auto& span : patterns) {
+            std::string_view pattern = std::string_view(source_).substr(span.pos, span.len);
+            if (is_gtest_name(pattern) ? glob_match(pattern, {gtest_prefix, name, suffix}, false, false)
+                           : glob_match(pattern, {name, suffix, {}}, true, !names_case(pattern))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string source_;
+    std::vector<Span> positive_;
+    std::vector<Span> negative_;
+    mutable std::vector<signed char> cache_;
+};
+
+inline TestFilter test_filter;
+
+inline bool matches_test_filters(const TestCase& test) {
+    if (test_filter.source() != test_filter_pattern) test_filter.compile(test_filter_pattern);
+    return test_filter.matches(test);
+}
+
+void write_junit_xml(const std::string& path, const std::vector<TestResult>& results, double total_time_ms);
+void write_json(const std::string& path, const std::vector<TestResult>& results, double total_time_ms);
+
+inline std::string json_output_path;
+inline std::string jsonl_output; // FILE or fd:N
+inline bool xml_stream = false;
+
+// Console flavour selected with --mt_reporter.
+enum class ConsoleMode { NORMAL, QUIET };
+inline ConsoleMode console_mode = ConsoleMode::NORMAL;
+
+inline bool show_help_only = false;
+
+// Number of worker threads used by run_all_tests (--mt_jobs / MT_JOBS).
+inline unsigned test_jobs = 1;
+
+// Default per-test time limit (--mt_timeout / MT_TIMEOUT); 0 disables it.
+inline std::chrono::milliseconds test_timeout{0};
+
+// Run tests in child processes (--mt_isolate / MT_ISOLATE).
+inline bool isolate_tests = false;
+
+// Distributed runs: serve tests to agents on host:port (--mt_coordinator /
+// MT_COORDINATOR), or pull them from a coordinator (--mt_agent / MT_AGENT).
+inline std::string coordinator_address;
+inline std::string agent_address;
+
+// Stop after the first failing test (--mt_fail_fast / --gtest_fail_fast).
+inline bool fail_fast = false;
+
+// Flake hunting: --gtest_repeat (negative: forever), --mt_until_fail,
+// --gtest_shuffle with --gtest_random_seed (0: pick one), --mt_stress.
+inline int repeat_count = 1;
+inline bool until_fail = false;
+inline bool shuffle_tests = false;
+inline std::uint32_t random_seed = 0;
+inline unsigned stress_threads = 1;
+
+// GoogleTest sharding protocol (GTEST_TOTAL_SHARDS / GTEST_SHARD_INDEX).
+enum class ShardBalance { ROUND_ROBIN, DURATION };
+inline int total_shards = 1;
+inline int shard_index = 0;
+inline std::string shard_status_file;
+inline ShardBalance shard_balance = ShardBalance::ROUND_ROBIN;
+
+// Recorded per-test durations (--mt_timings / MT_TIMINGS), read before the
+// run to order the worker queues and balance shards, and merged with this
+// run's durations afterwards. Empty (the default): no cache is read or
+// written.
+inline std::string timings_path;
+
+inline int parse_int(std::string_view value, int fallback) {
+    if (value.empty()) return fallback;
+    bool negative = value.front() == '-';
+    if (negative) value.remove_prefix(1);
+    if (value.empty()) return fallback;
+    int n = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9') return fallback;
+        n = n * 10 + (c - '0');
+    }
+    return negative ? -n : n;
+}
+
+inline ShardBalance parse_shard_balance(std::string_view value) {
+    return value == "duration" ? ShardBalance::DURATION : ShardBalance::ROUND_ROBIN;
+}
+
+// "auto" or 0 means one worker per hardware thread.
+inline unsigned parse_jobs(std::string_view value) {
+    unsigned n = 0;
+    if (value != "auto") {
+        for (char c : value) {
+            if (c < '0' || c > '9') return 1;
+            n = n * 10 + static_cast<unsigned>(c - '0');
+        }
+    }
+    if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+    return n;
+}
+
+// Environment variables mirror the flags (GoogleTest reads GTEST_<FLAG> the
+// same way); explicit command-line flags override them.
+void parse_environment();
+
+void parse_args(int argc, char* argv[]);
+
+// --- 5. REPORTERS ---
+struct RunInfo {
+    std::size_t to_run = 0;
+    std::size_t registered = 0;
+    unsigned jobs = 1;
+    int shard_index = 0;
+    int total_shards = 1;
+};
+
+struct RunSummary {
+    int passed = 0;
+    int failed = 0;
+    int skipped = 0;
+    double total_ms = 0.0;
+    const std::vector<TestResult>& results;
+};
+
+inline RunSummary summarize(const std::vector<TestResult>& results, double total_ms = 0.0) {
+    RunSummary summary{0, 0, 0, total_ms, results};
+    for (const auto& r : results) {
+        if (r.skipped) summary.skipped++;
+        else if (r.passed) summary.passed++;
+        else summary.failed++;
+    }
+    return summary;
+}
+
+// Receives a run as a stream of events. The runner serializes every call,
+// so implementations need no locking of their own. test_finished arrives
+// once per test, in completion order, carrying everything the test
+// produced (its buffered failures, benchmark statistics, ...);
+// test_started precedes it with just the name and location, except for
+// skipped tests. In between, failure_recorded reports each failure of a
+// test running in this process as it happens, with `hits` counting the
+// repeats folded into it so far; failures from isolated children and
+// agents, and notes the runner adds at the end, only arrive with
+// test_finished.
+class Reporter {
+public:
+    virtual ~Reporter() = default;
+    virtual void run_started(const RunInfo&) {}
+    virtual void test_started(const TestResult&) {}
+    virtual void failure_recorded(const TestResult&, const Failure&) {}
+    virtual void test_finished(const TestResult&) {}
+    virtual void run_finished(const RunSummary&) {}
+};
+
+// Reporters installed by the user, fed alongside the built-in ones.
+inline std::vector<std::unique_ptr<Reporter>>& custom_reporters() {
+    static std::vector<std::unique_ptr<Reporter>> reporters;
+    return reporters;
+}
+
+inline void add_reporter(std::unique_ptr<Reporter> reporter) {
+    custom_reporters().push_back(std::move(reporter));
+}
+
+// --- 6. WORKER POOL ---
+// Each worker owns a deque of task indices. It pops from the front of its
+// own deque and, once that runs dry, steals from the back of the others.
+// Tasks never spawn tasks, so a worker retires as soon as every deque is empty.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned workers)
+        : count_(std::max(1u, workers)), queues_(std::make_unique<Queue[]>(count_)) {}
+
+    unsigned size() const { return count_; }
+
+    void push(unsigned worker, std::size_t task) {
+        queues_[worker % count_].items.push_back(task);
+    }
+
+    // Runs fn(task, worker) for every queued task. The calling thread acts as
+    // worker 0, so a single-worker pool never spawns a thread.
+    template <typename F>
+    void run(F&& fn) {
+        auto work = [this, &fn](unsigned self) {
+            std::size_t task;
+            while (pop(self, task) || steal(self, task)) {
+                fn(task, self);
+            }
+        };
+        std::vector<std::thread> threads;
+        threads.reserve(count_ - 1);
+        for (unsigned w = 1; w < count_; ++w) threads.emplace_back(work, w);
+        work(0);
+        for (auto& t : threads) t.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::size_t> items;
+    };
+
+    bool pop(unsigned self, std::size_t& out) {
+        auto& q = queues_[self];
+        std::lock_guard lock(q.m);
+        if (q.items.empty()) return false;
+        out = q.items.front();
+        q.items.pop_front();
+        return true;
+    }
+
+    bool steal(unsigned self, std::size_t& out) {
+        for (unsigned i = 1; i < count_; ++i) {
+            auto& q = queues_[(self + i) % count_];
+            std::lock_guard lock(q.m);
+            if (q.items.empty()) continue;
+            out = q.items.back();
+            q.items.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    unsigned count_;
+    std::unique_ptr<Queue[]> queues_;
+};
+
+// Runs fn(index, worker) for index in [0, count) on `jobs` workers.
+template <typename F>
+void parallel_for_each(std::size_t count, unsigned jobs, F&& fn) {
+    WorkStealingPool pool(static_cast<unsigned>(std::min<std::size_t>(std::max(1u, jobs), std::max<std::size_t>(1, count))));
+    for (std::size_t i = 0; i < count; ++i) pool.push(static_cast<unsigned>(i % pool.size()), i);
+    pool.run(std::forward<F>(fn));
+}
+
+// --- 7. EVENT LOOP ---
+namespace detail {
+// A suspended coroutine and the test context to bind while it runs.
+struct Resumption {
+    std::coroutine_handle<> handle;
+    TestContext* test = nullptr;
+};
+
+// Single-threaded executor for TEST_ASYNC bodies: a ready queue, a timer
+// heap and a locked inbox for wake-ups posted from other threads. Only the
+// thread calling next() touches the queue and the heap.
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void schedule(Resumption r, Clock::time_point when) {
+        if (when <= Clock::now()) {
+            ready_.push_back(r);
+            return;
+        }
+        timers_.push_back({when, seq_++, r});
+        std::push_heap(timers_.begin(), timers_.end(), later);
+    }
+
+    void post(Resumption r) {
+        {
+            std::lock_guard lock(mutex_);
+            inbox_.push_back(r);
+        }
+        cv_.notify_one();
+    }
+
+    // The next resumption that is due, waiting for one until `until`;
+    // nullopt once `until` has passed with nothing due.
+    std::optional<Resumption> next(Clock::time_point until) {
+        for (;;) {
+            {
+                std::lock_guard lock(mutex_);
+                ready_.insert(ready_.end(), inbox_.begin(), inbox_.end());
+                inbox_.clear();
+            }
+            auto now = Clock::now();
+            while (!timers_.empty() && timers_.front().when <= now) {
+                std::pop_heap(timers_.begin(), timers_.end(), later);
+                ready_.push_back(timers_.back().r);
+                timers_.pop_back();
+            }
+            if (!ready_.empty()) {
+                Resumption r = ready_.front();
+                ready_.pop_front();
+                return r;
+            }
+            if (now >= until) return std::nullopt;
+            auto wake = timers_.empty() ? until : std::min(until, timers_.front().when);
+            std::unique_lock lock(mutex_);
+            cv_.wait_until(lock, wake, [&] { return !inbox_.empty(); });
+        }
+    }
+
+    // Drops everything queued for `test`, e.g. once it timed out.
+    void forget(const TestContext* test) {
+        std::erase_if(ready_, [&](const Resumption& r) { return r.test == test; });
+        std::erase_if(timers_, [&](const Timer& t) { return t.r.test == test; });
+        std::make_heap(timers_.begin(), timers_.end(), later);
+        std::lock_guard lock(mutex_);
+        std::erase_if(inbox_, [&](const Resumption& r) { return r.test == test; });
+    }
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        std::uint64_t seq; // FIFO among equal deadlines
+        Resumption r;
+    };
+    static bool later(const Timer& a, const Timer& b) { return a.when != b.when ? a.when > b.when : a.seq > b.seq; }
+
+    std::deque<Resumption> ready_;
+    std::vector<Timer> timers_;
+    std::uint64_t seq_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Resumption> inbox_;
+};
+
+// One TEST_ASYNC body in flight.
+struct AsyncRun {
+    const TestCase* test = nullptr;
+    TestContext* ctx = nullptr;
+    std::chrono::milliseconds limit{0}; // 0: none
+    task<> root;
+    double duration_ms = 0.0;
+    bool finished = false;
+    bool cancelled = false; // cut short by cancellation_requested()
+    // With `metered`, only the slices the loop spends inside this body are
+    // charged to `resources`; the other bodies' slices are not.
+    bool metered = false;
+    std::optional<ResourceUsage> resources;
+};
+
+// Starts every run and drives them on the calling thread until each has
+// finished or overrun its limit; a timed-out body is destroyed at its
+// suspension point and fails. Once cancellation is requested, the bodies
+// still suspended are destroyed the same way and marked cancelled.
+// on_finished(i) is called as runs[i] ends.
+void drive_async(std::span<AsyncRun> runs, const std::function<void(std::size_t)>& on_finished);
+
+// An ASYNC body on its own loop, bound to the current context.
+void run_async_body(const TestCase& test);
+} // namespace detail
+
+// --- 8. WATCHDOG ---
+// Tracks the test each worker is running and calls on_timeout(slot, limit)
+// from its own thread once one overruns. Workers publish with plain atomic
+// stores, so a watched run costs the pool no locking.
+class Watchdog {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Handler = std::function<void(std::size_t slot, std::chrono::milliseconds limit)>;
+
+    Watchdog(unsigned workers, Handler on_timeout)
+        : count_(std::max(1u, workers)), slots_(std::make_unique<Slot[]>(count_)),
+          on_timeout_(std::move(on_timeout)), thread_([this] { watch(); }) {}
+
+    ~Watchdog() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+    void begin(unsigned worker, std::size_t slot, std::chrono::milliseconds limit) {
+        auto& s = slots_[worker % count_];
+        s.slot.store(slot, std::memory_order_relaxed);
+        s.limit_ms.store(limit.count(), std::memory_order_relaxed);
+        s.deadline.store((Clock::now() + limit).time_since_epoch().count(), std::memory_order_release);
+    }
+
+    void end(unsigned worker) { slots_[worker % count_].deadline.store(0, std::memory_order_release); }
+
+private:
+    struct Slot {
+        std::atomic<Clock::rep> deadline{0}; // 0: idle
+        std::atomic<std::size_t> slot{0};
+        std::atomic<std::chrono::milliseconds::rep> limit_ms{0};
+    };
+
+    static constexpr auto poll_interval = std::chrono::milliseconds(10);
+
+    void watch() {
+        std::unique_lock lock(mutex_);
+        while (!cv_.wait_for(lock, poll_interval, [this] { return stop_; })) {
+            auto now = Clock::now().time_since_epoch().count();
+            for (unsigned w = 0; w < count_; ++w) {
+                auto& s = slots_[w];
+                auto deadline = s.deadline.load(std::memory_order_acquire);
+                if (deadline == 0 || now < deadline) continue;
+                std::size_t slot = s.slot.load(std::memory_order_relaxed);
+                std::chrono::milliseconds limit(s.limit_ms.load(std::memory_order_relaxed));
+                // The worker may have moved on while we read; only act on a
+                // consistent snapshot.
+                if (!s.deadline.compare_exchange_strong(deadline, 0, std::memory_order_acq_rel)) continue;
+                lock.unlock();
+                on_timeout_(slot, limit);
+                lock.lock();
+            }
+        }
+    }
+
+    unsigned count_;
+    std::unique_ptr<Slot[]> slots_;
+    Handler on_timeout_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+// --- 9. SHARDING ---
+// Timing file format: a "# moderntest-timings v1" header followed by one
+// "<duration_ms>\t<test name>" line per test.
+using TimingMap = std::unordered_map<std::string, double>;
+
+TimingMap load_timings(const std::string& path);
+
+// Written to a sibling file named after the pid and a random suffix, then
+// renamed into place, so a reader (or a crash) never observes a half-written
+// cache and concurrent runs never share a temp file. The last run to finish
+// wins; a failed write leaves the old cache and no temp file behind.
+bool save_timings(const std::string& path, const TimingMap& timings);
+
+// Decides which of `count` filtered tests belong to this shard.
+// Round-robin matches GoogleTest exactly (test i runs on shard i % total).
+// Duration balancing assigns tests longest-first to the least loaded shard;
+// every shard computes the same assignment from the same timing file.
+// Tests without a recorded duration are costed at the mean of the known ones.
+inline std::vector<bool> assign_shard(std::size_t count, int total, int index,
+                                      ShardBalance balance, const std::vector<double>& cost) {
+    std::vector<bool> mine(count, false);
+    if (balance == ShardBalance::ROUND_ROBIN || cost.size() != count) {
+        for (std::size_t i = 0; i < count; ++i) mine[i] = static_cast<int>(i % total) == index;
+        return mine;
+    }
+
+    std::vector<std::size_t> order(count);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+        [&](std::size_t a, std::size_t b) { return cost[a] > cost[b]; });
+
+    std::vector<double> load(static_cast<std::size_t>(total), 0.0);
+    for (std::size_t i : order) {
+        auto lightest = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        load[static_cast<std::size_t>(lightest)] += cost[i];
+        mine[i] = lightest == index;
+    }
+    return mine;
+}
+
+inline std::vector<double> estimate_costs(const std::vector<std::string_view>& names, const TimingMap& timings) {
+    double known_sum = 0.0;
+    std::size_t known = 0;
+    for (const auto& entry : timings) {
+        known_sum += entry.second;
+        known++;
+    }
+    double fallback = known ? known_sum / static_cast<double>(known) : 1.0;
+
+    std::vector<double> cost;
+    cost.reserve(names.size());
+    for (auto name : names) {
+        auto it = timings.find(std::string(name));
+        cost.push_back(it != timings.end() ? it->second : fallback);
+    }
+    return cost;
+}
+
+// Longest-processing-time-first order for the worker queues: tests without
+// a recorded duration go first (in registration order, since nothing is
+// known about them), then the rest by descending duration. Dealt
+// round-robin, every worker starts on one of the longest tests and the
+// short ones at the back of the queues are left for stealing.
+inline std::vector<std::size_t> lpt_order(const std::vector<std::string_view>& names, const TimingMap& timings) {
+    std::vector<std::size_t> order(names.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::vector<double> cost;
+    cost.reserve(names.size());
+    for (auto name : names) {
+        auto it = timings.find(std::string(name));
+        cost.push_back(it != timings.end() ? it->second : std::numeric_limits<double>::infinity());
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return cost[a] > cost[b]; });
+    return order;
+}
+
+// --- 10. ISOLATION ---
+// --mt_isolate runs tests in child processes so a crash fails one test
+// instead of the whole binary. Children are forked once up front and reused;
+// each receives test slots over a pipe and answers with one framed, binary
+// encoded result per test. POSIX only.
+
+namespace detail {
+// Little framing helpers for the result pipe. Values are written in host
+// byte order: both ends are the same binary.
+class WireWriter {
+public:
+    template <typename T>
+    void put(T value) requires std::is_trivially_copyable_v<T> {
+        buf_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void put_string(std::string_view s) {
+        put(static_cast<std::uint32_t>(s.size()));
+        buf_.append(s);
+    }
+    std::string& data() { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+class WireReader {
+public:
+    explicit WireReader(std::string_view data) : data_(data) {}
+
+    template <typename T>
+    T get() requires std::is_trivially_copyable_v<T> {
+        T value{};
+        if (data_.size() < sizeof(T)) {
+            ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return value;
+    }
+    std::string get_string() {
+        auto size = get<std::uint32_t>();
+        if (!ok_ || data_.size() < size) {
+            ok_ = false;
+            return {};
+        }
+        std::string s(data_.substr(0, size));
+        data_.remove_prefix(size);
+        return s;
+    }
+    bool ok() const { return ok_; }
+
+private:
+    std::string_view data_;
+    bool ok_ = true;
+};
+
+// Only the fields a test run produces; name, file and line stay with the
+// parent's copy of the result.
+inline std::string encode_result(std::uint64_t slot, const TestResult& r) {
+    WireWriter w;
+    w.put<std::uint32_t>(0); // frame length, patched below
+    w.put(slot);
+    w.put<std::uint8_t>(r.passed);
+    w.put(r.duration_ms);
+    w.put(static_cast<std::uint32_t>(r.failures.size()));
+    for (const auto& f : r.failures) {
+        w.put(static_cast<std::int32_t>(f.line));
+        w.put_string(f.file);
+        w.put_string(f.message);
+        w.put(static_cast<std::uint64_t>(f.hits));
+        w.put(static_cast<std::uint32_t>(f.recent.size()));
+        for (const auto& m : f.recent) w.put_string(m);
+    }
+    w.put<std::uint8_t>(r.resources.has_value());
+    if (r.resources) w.put(*r.resources);
+    w.put<std::uint8_t>(r.bench.has_value());
+    if (r.bench) {
+        const auto& b = *r.bench;
+        w.put(b.iterations);
+        w.put(static_cast<std::uint32_t>(b.samples_ns.size()));
+        for (double s : b.samples_ns) w.put(s);
+        w.put(b.mean_ns);
+        w.put(b.median_ns);
+        w.put(b.stddev_ns);
+        w.put(b.min_ns);
+        w.put(b.items_per_second);
+        w.put(b.bytes_per_second);
+        w.put<std::uint8_t>(b.comparison.has_value());
+        if (b.comparison) w.put(*b.comparison);
+        w.put<std::uint8_t>(b.counters.has_value());
+        if (b.counters) w.put(*b.counters);
+    }
+    auto& out = w.data();
+    auto length = static_cast<std::uint32_t>(out.size() - sizeof(std::uint32_t));
+    std::memcpy(out.data(), &length, sizeof(length));
+    return std::move(out);
+}
+
+// Decodes a frame payload (without its length prefix) into `result`.
+inline bool decode_result(std::string_view payload, std::uint64_t& slot, TestResult& result) {
+    WireReader r(payload);
+    slot = r.get<std::uint64_t>();
+    result.passed = r.get<std::uint8_t>() != 0;
+    result.duration_ms = r.get<double>();
+    auto failures = r.get<std::uint32_t>();
+    for (std::uint32_t i = 0; i < failures && r.ok(); ++i) {
+        Failure f;
+        f.line = r.get<std::int32_t>();
+        f.file = r.get_string();
+        f.message = r.get_string();
+        f.hits = static_cast<std::size_t>(r.get<std::uint64_t>());
+        auto recent = r.get<std::uint32_t>();
+        for (std::uint32_t m = 0; m < recent && r.ok(); ++m) f.recent.push_back(r.get_string());
+        result.failures.push_back(std::move(f));
+    }
+    if (r.get<std::uint8_t>()) result.resources = r.get<ResourceUsage>();
+    if (r.get<std::uint8_t>()) {
+        BenchResult b;
+        b.iterations = r.get<std::uint64_t>();
+        auto samples = r.get<std::uint32_t>();
+        for (std::uint32_t i = 0; i < samples && r.ok(); ++i) b.samples_ns.push_back(r.get<double>());
+        b.mean_ns = r.get<double>();
+        b.median_ns = r.get<double>();
+        b.stddev_ns = r.get<double>();
+        b.min_ns = r.get<double>();
+        b.items_per_second = r.get<double>();
+        b.bytes_per_second = r.get<double>();
+        if (r.get<std::uint8_t>()) b.comparison = r.get<BenchComparison>();
+        if (r.get<std::uint8_t>()) b.counters = r.get<PerfCounters>();
+        result.bench = std::move(b);
+    }
+    return r.ok();
+}
+
+// Copies what a remote run produced into the local, pre-filled result.
+inline void merge_result(TestResult& into, TestResult&& from) {
+    into.passed = from.passed;
+    into.duration_ms = from.duration_ms;
+    into.failures = std::move(from.failures);
+    into.resources = from.resources;
+    into.bench = std::move(from.bench);
+}
+
+} // namespace detail
+
+// --- 11. DISTRIBUTED ---
+// --mt_coordinator=HOST:PORT serves the selected tests to agents running the
+// same binary with --mt_agent=HOST:PORT. Each agent connection pulls one
+// test at a time and answers with the isolation wire format, so fast
+// agents simply run more tests; the coordinator reports as if the tests had
+// run locally. POSIX only.
+namespace detail {
+// Commands sent to an agent: a registry index, or one of these.
+inline constexpr std::uint64_t agent_quit = ~std::uint64_t{0};
+inline constexpr std::uint64_t agent_rejected = agent_quit - 1;
+inline constexpr std::uint32_t agent_hello_magic = 0x3144544d; // "MTD1", also catches byte-order mismatches
+
+// Identifies the registry by its test names, case numbers and kinds in
+// registration order: agents must hold exactly the coordinator's tests for
+// registry indices to mean the same test on both sides.
+inline std::uint64_t registry_fingerprint(const TestRegistry& tests) {
+    std::uint64_t h = 1469598103934665603ull; // FNV-1a
+    auto mix = [&](const void* data, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i) {
+            h ^= static_cast<const unsigned char*>(data)[i];
+            h *= 1099511628211ull;
+        }
+    };
+    for (const auto& t : tests) {
+        mix(t.name.data(), t.name.size());
+        auto case_number = static_cast<std::uint64_t>(t.case_number);
+        mix(&case_number, sizeof(case_number));
+        auto kind = static_cast<std::uint8_t>(t.kind);
+        mix(&kind, sizeof(kind));
+    }
+    return h;
+}
+
+// "host:port" or "[v6-address]:port"; an empty host means every interface.
+inline bool split_host_port(std::string_view address, std::string& host, std::string& port) {
+    auto colon = address.rfind(':');
+    if (colon == std::string_view::npos || colon + 1 == address.size()) return false;
+    std::string_view h = address.substr(0, colon);
+    if (h.size() >= 2 && h.front() == '[' && h.back() == ']') h = h.substr(1, h.size() - 2);
+    host = std::string(h);
+    port = std::string(address.substr(colon + 1));
+    return port.find_first_not_of("0123456789") == std::string::npos;
+}
+} // namespace detail
+
+// Agent mode: connects `test_jobs` times to the coordinator and runs what it
+// hands out until told to quit. Returns the process exit code.
+int run_agent(const std::string& address);
+
+// --- 12. RUNNER ---
+namespace detail {
+// Runs the body on the calling thread; exceptions become failures of the
+// bound context.
+inline void invoke_test_body(const TestCase& test, TestResult& result) {
+    try {
+        if (test.kind == TestKind::BENCH) {
+            result.bench = measure_benchmark(test);
+        } else if (test.kind == TestKind::ASYNC) {
+            run_async_body(test);
+        } else {
+            test.func();
+        }
+    } catch (const std::exception& e) {
+        record_failure(test.file, test.line, std::string("Unhandled exception: ") + e.what());
+    } catch (...) {
+        record_failure(test.file, test.line, "Unknown exception thrown");
+    }
+}
+
+// --mt_stress: the body runs on stress_threads threads released together,
+// each with its own context. Failures are merged into `ctx`, tagged with
+// the thread that saw them.
+inline void run_stressed(const TestCase& test, TestContext& ctx, TestResult& result) {
+    const unsigned n = stress_threads;
+    std::vector<TestContext> contexts(n);
+    contexts[0].file = test.file;
+    std::latch start(static_cast<std::ptrdiff_t>(n));
+    std::vector<std::thread> threads;
+    threads.reserve(n - 1);
+    for (unsigned k = 1; k < n; ++k) {
+        threads.emplace_back([&, k] {
+            contexts[k].file = test.file;
+            ContextScope scope(contexts[k]);
+            TestResult scratch;
+            start.arrive_and_wait();
+            invoke_test_body(test, scratch);
+        });
+    }
+    {
+        ContextScope scope(contexts[0]);
+        start.arrive_and_wait();
+        invoke_test_body(test, result);
+    }
+    for (auto& t : threads) t.join();
+
+    for (unsigned k = 0; k < n; ++k) {
+        for (auto& f : contexts[k].failures) {
+            f.message = "[stress thread " + std::to_string(k) + "] " + f.message;
+            ctx.failures.push_back(std::move(f));
+        }
+        ctx.suppressed += contexts[k].suppressed;
+        ctx.failed = ctx.failed || contexts[k].failed;
+    }
+}
+} // namespace detail
+
+void run_test(const TestCase& test, TestResult& result);
+
+// Per-test outcome counts across the iterations of one run_all_tests call,
+// indexed by registration order.
+struct TestTally {
+    std::string name;
+    int runs = 0;
+    int failures = 0;
+};
+
+inline std::vector<TestTally>& get_tallies() {
+    static std::vector<TestTally> tallies;
+    return tallies;
+}
+
+// Deterministic for a given seed on every standard library, unlike
+// std::shuffle with a distribution.
+inline void shuffle_order(std::vector<std::size_t>& order, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (std::size_t i = order.size(); i > 1; --i) {
+        std::swap(order[i - 1], order[rng() % i]);
+    }
+}
+
+// Seeds stay in GoogleTest's [1, 99999] range and advance by one per iteration.
+inline std::uint32_t iteration_seed(std::uint32_t seed, int iteration) {
+    return (seed - 1 + static_cast<std::uint32_t>(iteration)) % 99999u + 1;
+}
+
+// Moves every test that uses a fixture next to the first of them in
+// `order`, keyed by its first declared fixture, so the fixture's users
+// finish close together and it can be torn down early. Tests without
+// fixtures, and the order within a batch, are left as they are.
+inline void batch_by_fixture(std::vector<std::size_t>& order, const std::vector<const TestCase*>& tests) {
+    auto key = [&](std::size_t slot) { return tests[slot]->fixtures.empty() ? nullptr : tests[slot]->fixtures.front(); };
+    std::unordered_map<const detail::FixtureBase*, std::vector<std::size_t>> batches;
+    for (std::size_t slot : order) {
+        if (auto* k = key(slot)) batches[k].push_back(slot);
+    }
+    if (batches.empty()) return;
+    std::vector<std::size_t> batched;
+    batched.reserve(order.size());
+    for (std::size_t slot : order) {
+        auto* k = key(slot);
+        if (!k) {
+            batched.push_back(slot);
+            continue;
+        }
+        auto it = batches.find(k);
+        if (it == batches.end()) continue; // already emitted with its batch
+        batched.insert(batched.end(), it->second.begin(), it->second.end());
+        batches.erase(it);
+    }
+    order = std::move(batched);
+}
+
+void print_tallies(int iterations);
+
+// One pass over the selected tests. Returns the number of failed tests.
+int run_iteration(int iteration);
+
+} // namespace mt
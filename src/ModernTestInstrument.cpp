@@ -0,0 +1,406 @@
+// Runner-side instrumentation: replaceable global allocation functions that
+// feed mt::detail::alloc_counters, a platform resource sampler for
+// --mt_instrument, hardware counters for --mt_perf_counters and the
+// per-thread event buffers of --mt_trace. Linked into ModernTest_Runner so header-only users of
+// ModernTest_Core keep the default allocator.
+#include "ModernTestRunner.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(_WIN32)
+double filetime_ms(const FILETIME& t) {
+    ULARGE_INTEGER v;
+    v.LowPart = t.dwLowDateTime;
+    v.HighPart = t.dwHighDateTime;
+    return static_cast<double>(v.QuadPart) / 10000.0; // 100 ns ticks
+}
+
+mt::ResourceSample sample_platform_resources() {
+    mt::ResourceSample s;
+    FILETIME created, exited, kernel, user;
+    if (GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+        s.user_cpu_ms = filetime_ms(user);
+        s.system_cpu_ms = filetime_ms(kernel);
+    }
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        s.peak_rss_kb = static_cast<std::uint64_t>(pmc.PeakWorkingSetSize / 1024);
+    }
+    return s;
+}
+#else
+double timeval_ms(const timeval& t) { return t.tv_sec * 1000.0 + t.tv_usec / 1000.0; }
+
+mt::ResourceSample sample_platform_resources() {
+    mt::ResourceSample s;
+    rusage usage{};
+#if defined(RUSAGE_THREAD)
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        s.user_cpu_ms = timeval_ms(usage.ru_utime);
+        s.system_cpu_ms = timeval_ms(usage.ru_stime);
+    }
+    rusage self{};
+    if (getrusage(RUSAGE_SELF, &self) == 0) usage.ru_maxrss = self.ru_maxrss;
+#else
+    // No per-thread accounting (macOS): fall back to the whole process.
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        s.user_cpu_ms = timeval_ms(usage.ru_utime);
+        s.system_cpu_ms = timeval_ms(usage.ru_stime);
+    }
+#endif
+#if defined(__APPLE__)
+    s.peak_rss_kb = static_cast<std::uint64_t>(usage.ru_maxrss) / 1024; // bytes on macOS
+#else
+    s.peak_rss_kb = static_cast<std::uint64_t>(usage.ru_maxrss); // kilobytes on Linux/BSD
+#endif
+    return s;
+}
+#endif
+
+const bool sampler_installed = [] {
+    mt::detail::sample_resources = &sample_platform_resources;
+    return true;
+}();
+
+#if defined(__linux__)
+struct PerfEventSpec {
+    std::uint32_t type;
+    std::uint64_t config;
+};
+
+// In the order of mt::PerfCounters' fields.
+constexpr PerfEventSpec perf_event_specs[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int open_perf_event(const PerfEventSpec& spec, int group) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group < 0 ? 1 : 0; // members follow the leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC));
+}
+#endif
+
+// Each thread appends to its own buffer; the log keeps the buffers alive
+// after their threads exit so the runner can collect them at the end.
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<mt::TraceEvent> events;
+};
+
+struct TraceLog {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::map<std::uint32_t, std::string> tracks;
+    std::uint32_t next_thread_track = mt::detail::first_thread_track;
+    mt::detail::TraceClock::time_point origin{};
+};
+
+TraceLog& trace_log() {
+    static TraceLog log;
+    return log;
+}
+
+TraceBuffer& thread_trace_buffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer = [] {
+        auto b = std::make_shared<TraceBuffer>();
+        auto& log = trace_log();
+        std::lock_guard lock(log.mutex);
+        log.buffers.push_back(b);
+        return b;
+    }();
+    return *buffer;
+}
+
+std::uint32_t thread_trace_track() {
+    auto& track = mt::detail::trace_track;
+    if (track == 0) {
+        auto& log = trace_log();
+        std::lock_guard lock(log.mutex);
+        track = log.next_thread_track++;
+        log.tracks.emplace(track, "thread " + std::to_string(track - mt::detail::first_thread_track + 1));
+    }
+    return track;
+}
+
+double trace_us(mt::detail::TraceClock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t - trace_log().origin).count();
+}
+
+void append_trace_event(mt::TraceEvent event) {
+    auto& buffer = thread_trace_buffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.events.push_back(std::move(event));
+}
+
+void trace_user_span(std::string_view name, std::string_view category, mt::detail::TraceClock::time_point start,
+                     mt::detail::TraceClock::time_point end) {
+    mt::detail::record_trace_span(name, category, start, end);
+}
+
+void trace_user_counter(std::string_view name, double value) {
+    mt::TraceEvent event;
+    event.name = name;
+    event.category = "counter";
+    event.ts_us = trace_us(mt::detail::TraceClock::now());
+    event.value = value;
+    event.counter = true;
+    append_trace_event(std::move(event));
+}
+
+constexpr mt::detail::TraceSinks trace_recorder{&trace_user_span, &trace_user_counter};
+
+} // namespace
+
+namespace mt::detail {
+
+#if defined(__linux__)
+PerfCounterGroup::PerfCounterGroup() {
+    for (std::size_t i = 0; i < fds_.size(); ++i) {
+        fds_[i] = open_perf_event(perf_event_specs[i], leader_);
+        if (fds_[i] < 0) {
+            if (error_.empty()) error_ = std::string("perf_event_open: ") + std::strerror(errno);
+            continue;
+        }
+        if (leader_ < 0) leader_ = fds_[i];
+    }
+    if (leader_ >= 0) error_.clear();
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+    for (int fd : fds_) {
+        if (fd >= 0) ::close(fd);
+    }
+}
+
+void PerfCounterGroup::enable() {
+    if (leader_ >= 0) ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounterGroup::disable() {
+    if (leader_ >= 0) ::ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounterGroup::reset() {
+    if (leader_ >= 0) ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters PerfCounterGroup::read() const {
+    std::optional<double> values[5];
+    for (std::size_t i = 0; i < fds_.size(); ++i) {
+        std::uint64_t data[3]{}; // value, time enabled, time running
+        if (fds_[i] < 0 || ::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+        if (data[2] == 0) {
+            // Never scheduled: either nothing was counted yet or the PMU
+            // could not fit the group.
+            if (data[1] == 0) values[i] = 0.0;
+            continue;
+        }
+        values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+    }
+    return {values[0], values[1], values[2], values[3], values[4]};
+}
+#else
+PerfCounterGroup::PerfCounterGroup() : error_("hardware counters need Linux perf_event") {}
+PerfCounterGroup::~PerfCounterGroup() = default;
+void PerfCounterGroup::enable() {}
+void PerfCounterGroup::disable() {}
+void PerfCounterGroup::reset() {}
+PerfCounters PerfCounterGroup::read() const { return {}; }
+#endif
+
+void start_trace() {
+    auto& log = trace_log();
+    {
+        std::lock_guard lock(log.mutex);
+        for (auto& buffer : log.buffers) {
+            std::lock_guard buffer_lock(buffer->mutex);
+            buffer->events.clear();
+        }
+        log.tracks.clear();
+        log.origin = TraceClock::now();
+    }
+    trace_sinks.store(&trace_recorder, std::memory_order_release);
+}
+
+void stop_trace() { trace_sinks.store(nullptr, std::memory_order_release); }
+
+bool tracing() { return trace_sinks.load(std::memory_order_relaxed) != nullptr; }
+
+void name_trace_track(std::uint32_t track, std::string name) {
+    auto& log = trace_log();
+    std::lock_guard lock(log.mutex);
+    log.tracks[track] = std::move(name);
+}
+
+void record_trace_span(std::string_view name, std::string_view category, TraceClock::time_point start,
+                       TraceClock::time_point end, std::uint32_t track, std::string args) {
+    if (!tracing()) return;
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.args = std::move(args);
+    event.ts_us = trace_us(start);
+    event.value = std::chrono::duration<double, std::micro>(end - start).count();
+    event.track = track != 0 ? track : thread_trace_track();
+    append_trace_event(std::move(event));
+}
+
+std::vector<TraceEvent> collect_trace() {
+    std::vector<TraceEvent> events;
+    auto& log = trace_log();
+    std::lock_guard lock(log.mutex);
+    for (auto& buffer : log.buffers) {
+        std::lock_guard buffer_lock(buffer->mutex);
+        events.insert(events.end(), buffer->events.begin(), buffer->events.end());
+    }
+    // Enclosing spans first when two start together, so viewers nest them.
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        if (a.ts_us != b.ts_us) return a.ts_us < b.ts_us;
+        return !a.counter && !b.counter && a.value > b.value;
+    });
+    return events;
+}
+
+std::map<std::uint32_t, std::string> trace_track_names() {
+    auto& log = trace_log();
+    std::lock_guard lock(log.mutex);
+    return log.tracks;
+}
+
+} // namespace mt::detail
+
+#if defined(MODERNTEST_ALLOC_HOOKS)
+
+namespace {
+
+const bool hooks_installed = [] {
+    mt::detail::alloc_hooks_active.store(true, std::memory_order_relaxed);
+    return true;
+}();
+
+void count_allocation(std::size_t size) noexcept {
+    auto& c = mt::detail::alloc_counters;
+    ++c.count;
+    c.bytes += size;
+}
+
+void* allocate(std::size_t size) {
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) {
+            count_allocation(size);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocate_aligned(std::size_t size, std::align_val_t al) {
+    auto align = static_cast<std::size_t>(al);
+    if (align < sizeof(void*)) align = sizeof(void*);
+    if (size == 0) size = 1;
+    for (;;) {
+#if defined(_WIN32)
+        void* p = _aligned_malloc(size, align);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, align, size) != 0) p = nullptr;
+#endif
+        if (p) {
+            count_allocation(size);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void release_aligned(void* p) noexcept {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+void* operator new(std::size_t size, std::align_val_t al) { return allocate_aligned(size, al); }
+void* operator new[](std::size_t size, std::align_val_t al) { return allocate_aligned(size, al); }
+
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    try {
+        return allocate_aligned(size, al);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t& tag) noexcept {
+    return operator new(size, al, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release_aligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release_aligned(p); }
+
+#endif // MODERNTEST_ALLOC_HOOKS
@@ -0,0 +1,2572 @@
+#include "ModernTestRunner.hpp"
+
+#include <cerrno>
+#include <fstream>
+#if defined(_WIN32)
+#include <io.h>
+#include <process.h>
+#else
+#include <csignal>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace mt {
+
+// --- 3. BENCHMARKS ---
+std::optional<BenchResult> measure_benchmark(const TestCase& test) {
+    struct Run { double ns; std::uint64_t items, bytes; };
+    auto& ctx = current_test();
+    std::optional<detail::PerfCounterGroup> counters;
+    auto run = [&](std::uint64_t iterations, detail::CounterGroup* group = nullptr) {
+        BenchState state(iterations);
+        state.count_with(group);
+        test.bench(state);
+        if (!state.looped()) throw std::logic_error("BENCH body never iterated over its BenchState");
+        return Run{state.elapsed_ns(), state.items_processed(), state.bytes_processed()};
+    };
+
+    if (!bench_enabled) {
+        run(1);
+        return std::nullopt;
+    }
+
+    constexpr std::uint64_t max_iterations = 1'000'000'000;
+    const double target_ns = bench_min_time_ms * 1e6;
+
+    // Warmup doubles the batch size until the time budget is spent; the last
+    // batch size is where calibration starts.
+    std::uint64_t n = 1;
+    {
+        trace_scope phase("warmup", "bench");
+        for (double spent = 0.0; spent < bench_warmup_ms * 1e6 && n < max_iterations && !ctx.failed; ) {
+            spent += run(n).ns;
+            if (spent < bench_warmup_ms * 1e6) n *= 2;
+        }
+    }
+
+    {
+        trace_scope phase("calibration", "bench");
+        for (;;) {
+            Run r = run(n);
+            if (ctx.failed) return std::nullopt;
+            if (r.ns >= target_ns || n >= max_iterations) break;
+            double scale = r.ns > 0.0 ? std::clamp(target_ns * 1.2 / r.ns, 1.5, 10.0) : 10.0;
+            n = std::min(max_iterations, static_cast<std::uint64_t>(static_cast<double>(n) * scale) + 1);
+        }
+    }
+
+    BenchResult result;
+    result.iterations = n;
+    double total_ns = 0.0, items = 0.0, bytes = 0.0;
+    // Counted over the timed repetitions only, like the clock.
+    if (perf_counters_enabled) {
+        counters.emplace();
+        if (counters->available()) counters->reset();
+        else counters.reset();
+    }
+    const int repetitions = std::max(1, bench_repetitions);
+    for (int rep = 0; rep < repetitions; ++rep) {
+        trace_scope phase(detail::tracing() ? "repetition " + std::to_string(rep + 1) : std::string(), "bench");
+        Run r = run(n, counters ? &*counters : nullptr);
+        if (ctx.failed) return std::nullopt;
+        result.samples_ns.push_back(r.ns / static_cast<double>(n));
+        total_ns += r.ns;
+        items += static_cast<double>(r.items);
+        bytes += static_cast<double>(r.bytes);
+    }
+    summarize(result);
+    if (total_ns > 0.0) {
+        result.items_per_second = items / (total_ns * 1e-9);
+        result.bytes_per_second = bytes / (total_ns * 1e-9);
+    }
+    if (counters) result.counters = scale_counters(counters->read(), 1.0 / (static_cast<double>(n) * repetitions));
+    return result;
+}
+
+BenchBaseline load_bench_baseline(const std::string& path) {
+    BenchBaseline baseline;
+    std::ifstream in(path);
+    std::string line;
+    bool has_counters = false;
+    while (std::getline(in, line)) {
+        if (line.starts_with("# moderntest-bench v")) has_counters = line != "# moderntest-bench v1";
+        if (line.empty() || line.front() == '#') continue;
+        auto tab1 = line.find('\t');
+        auto tab2 = tab1 == std::string::npos ? tab1 : line.find('\t', tab1 + 1);
+        auto tab3 = tab2 == std::string::npos || !has_counters ? tab2 : line.find('\t', tab2 + 1);
+        if (tab3 == std::string::npos) continue;
+
+        BenchResult r;
+        r.iterations = std::strtoull(line.c_str(), nullptr, 10);
+        const char* p = line.c_str() + tab1 + 1;
+        const char* samples_end = line.c_str() + tab2;
+        while (p < samples_end) {
+            char* next = nullptr;
+            r.samples_ns.push_back(std::strtod(p, &next));
+            if (next == p) break;
+            p = next + (*next == ',' ? 1 : 0);
+        }
+        summarize(r);
+        if (tab3 != tab2) {
+            std::string_view fields = std::string_view(line).substr(tab2 + 1, tab3 - tab2 - 1);
+            PerfCounters counters;
+            bool any = false;
+            while (!fields.empty()) {
+                auto comma = fields.find(',');
+                auto field = fields.substr(0, comma);
+                fields = comma == std::string_view::npos ? std::string_view{} : fields.substr(comma + 1);
+                auto eq = field.find('=');
+                if (eq == std::string_view::npos) continue;
+                for (const auto& [name, member] : perf_counter_fields) {
+                    if (field.substr(0, eq) != name) continue;
+                    counters.*member = std::strtod(std::string(field.substr(eq + 1)).c_str(), nullptr);
+                    any = true;
+                }
+            }
+            if (any) r.counters = counters;
+        }
+        baseline[line.substr(tab3 + 1)] = std::move(r);
+    }
+    return baseline;
+}
+
+bool save_bench_baseline(const std::string& path, const std::vector<TestResult>& results) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+    out.precision(10);
+    out << "# moderntest-bench v2\n";
+    for (const auto& r : results) {
+        if (!r.bench) continue;
+        out << r.bench->iterations << '\t';
+        for (std::size_t i = 0; i < r.bench->samples_ns.size(); ++i) {
+            out << (i ? "," : "") << r.bench->samples_ns[i];
+        }
+        out << '\t';
+        const char* sep = "";
+        if (r.bench->counters) {
+            for (const auto& [name, member] : perf_counter_fields) {
+                if (const auto& v = (*r.bench->counters).*member) {
+                    out << sep << name << '=' << *v;
+                    sep = ",";
+                }
+            }
+        }
+        out << (*sep ? "" : "-") << '\t' << r.name << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// --- 4. UTILITIES ---
+namespace {
+std::string escape_xml(const std::string& str) {
+    std::string result;
+    for (char c : str) {
+        switch (c) {
+            case '&':  result += "&amp;"; break;
+            case '<':  result += "&lt;"; break;
+            case '>':  result += "&gt;"; break;
+            case '"':  result += "&quot;"; break;
+            case '\'': result += "&apos;"; break;
+            default:   result += c;
+        }
+    }
+    return result;
+}
+
+void write_junit_testcase(std::ostream& out, const TestResult& r) {
+    out << "    <testcase name=\"" << escape_xml(r.name) 
+        << "\" file=\"" << escape_xml(r.file) 
+        << "\" line=\"" << r.line
+        << "\" time=\"" << (r.duration_ms / 1000.0) << "\"";
+    
+    if (r.passed && !r.skipped && !r.bench && !r.resources) {
+        out << "/>\n";
+        return;
+    }
+    out << ">\n";
+    if (r.bench || r.resources) {
+        out << "      <properties>\n";
+    }
+    auto property = [&](std::string_view key, auto value) {
+        out << "        <property name=\"" << key << "\" value=\"" << value << "\"/>\n";
+    };
+    auto counter_properties = [&](std::string_view prefix, const std::optional<PerfCounters>& c) {
+        if (!c) return;
+        for (const auto& [name, member] : perf_counter_fields) {
+            if (const auto& v = (*c).*member) property(std::string(prefix).append(name), *v);
+        }
+        if (auto ipc = c->ipc()) property(std::string(prefix).append("ipc"), *ipc);
+    };
+    if (r.resources) {
+        const auto& u = *r.resources;
+        property("resource.user_cpu_ms", u.user_cpu_ms);
+        property("resource.system_cpu_ms", u.system_cpu_ms);
+        property("resource.allocations", u.allocations);
+        property("resource.allocated_bytes", u.allocated_bytes);
+        property("resource.peak_rss_delta_kb", u.peak_rss_delta_kb);
+        counter_properties("resource.", u.counters);
+    }
+    if (r.bench) {
+        const auto& b = *r.bench;
+        property("bench.iterations", b.iterations);
+        property("bench.repetitions", b.samples_ns.size());
+        property("bench.mean_ns", b.mean_ns);
+        property("bench.median_ns", b.median_ns);
+        property("bench.stddev_ns", b.stddev_ns);
+        property("bench.min_ns", b.min_ns);
+        if (b.items_per_second > 0.0) property("bench.items_per_second", b.items_per_second);
+        if (b.bytes_per_second > 0.0) property("bench.bytes_per_second", b.bytes_per_second);
+        counter_properties("bench.", b.counters);
+    }
+    if (r.bench || r.resources) {
+        out << "      </properties>\n";
+    }
+    if (r.skipped) {
+        out << "      <skipped/>\n";
+    }
+    for (const auto& f : r.failures) {
+        out << "      <failure message=\"" << escape_xml(describe(f)) << "\"/>\n";
+    }
+    out << "    </testcase>\n";
+}
+
+void append_json_escaped(std::string& result, std::string_view str) {
+    for (char c : str) {
+        switch (c) {
+            case '"':  result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static constexpr char hex[] = "0123456789abcdef";
+                    result += "\\u00";
+                    result += hex[(c >> 4) & 0xf];
+                    result += hex[c & 0xf];
+                } else {
+                    result += c;
+                }
+        }
+    }
+}
+
+std::string escape_json(std::string_view str) {
+    std::string result;
+    append_json_escaped(result, str);
+    return result;
+}
+
+// {"cycles": 1204.5, ..., "ipc": 2.31}
+void append_counters_json(std::string& out, const PerfCounters& c) {
+    char number[32];
+    auto value = [&](double v) {
+        auto [end, ec] = std::to_chars(number, number + sizeof(number), v);
+        out.append(number, end);
+    };
+    const char* sep = "{";
+    for (const auto& [name, member] : perf_counter_fields) {
+        if (const auto& v = c.*member) {
+            append(out, sep, "\"", name, "\": ");
+            value(*v);
+            sep = ", ";
+        }
+    }
+    if (auto ipc = c.ipc()) {
+        append(out, sep, "\"ipc\": ");
+        value(*ipc);
+        sep = ", ";
+    }
+    append(out, *sep == '{' ? "{}" : "}");
+}
+
+std::string counters_json(const PerfCounters& c) {
+    std::string out;
+    append_counters_json(out, c);
+    return out;
+}
+
+} // namespace
+
+void write_junit_xml(const std::string& path, const std::vector<TestResult>& results, double total_time_ms) {
+    std::ofstream out(path);
+    if (!out) return;
+    
+    int failures = 0, skipped = 0;
+    for (const auto& r : results) {
+        if (r.skipped) skipped++;
+        else if (!r.passed) failures++;
+    }
+    
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    out << "<testsuites tests=\"" << results.size() 
+        << "\" failures=\"" << failures 
+        << "\" skipped=\"" << skipped
+        << "\" time=\"" << (total_time_ms / 1000.0) << "\">\n";
+    out << "  <testsuite name=\"ModernTest\" tests=\"" << results.size() 
+        << "\" failures=\"" << failures 
+        << "\" skipped=\"" << skipped
+        << "\" time=\"" << (total_time_ms / 1000.0) << "\">\n";
+    
+    for (const auto& r : results) {
+        write_junit_testcase(out, r);
+    }
+    
+    out << "  </testsuite>\n</testsuites>\n";
+}
+
+void write_json(const std::string& path, const std::vector<TestResult>& results, double total_time_ms) {
+    std::ofstream out(path);
+    if (!out) return;
+    out.precision(10);
+
+    int failures = 0, skipped = 0;
+    for (const auto& r : results) {
+        if (r.skipped) skipped++;
+        else if (!r.passed) failures++;
+    }
+
+    out << "{\n  \"name\": \"" << default_suite_name << "\",\n"
+        << "  \"tests\": " << results.size() << ",\n"
+        << "  \"failures\": " << failures << ",\n"
+        << "  \"skipped\": " << skipped << ",\n"
+        << "  \"time_ms\": " << total_time_ms << ",\n"
+        << "  \"testcases\": [";
+
+    const char* sep = "\n";
+    for (const auto& r : results) {
+        out << sep << "    {\"name\": \"" << escape_json(r.name)
+            << "\", \"file\": \"" << escape_json(r.file)
+            << "\", \"line\": " << r.line
+            << ", \"status\": \"" << (r.skipped ? "skipped" : r.passed ? "passed" : "failed")
+            << "\", \"duration_ms\": " << r.duration_ms
+            << ", \"failures\": [";
+        for (std::size_t i = 0; i < r.failures.size(); ++i) {
+            const auto& f = r.failures[i];
+            out << (i ? ", " : "") << "{\"file\": \"" << escape_json(f.file) << "\", \"line\": " << f.line
+                << ", \"message\": \"" << escape_json(f.message) << "\"";
+            if (f.hits > 1) {
+                out << ", \"hits\": " << f.hits << ", \"recent\": [";
+                for (std::size_t m = 0; m < f.recent.size(); ++m) out << (m ? ", " : "") << '"' << escape_json(f.recent[m]) << '"';
+                out << "]";
+            }
+            out << "}";
+        }
+        out << "]";
+        if (r.resources) {
+            const auto& u = *r.resources;
+            out << ", \"resources\": {\"user_cpu_ms\": " << u.user_cpu_ms
+                << ", \"system_cpu_ms\": " << u.system_cpu_ms
+                << ", \"allocations\": " << u.allocations
+                << ", \"allocated_bytes\": " << u.allocated_bytes
+                << ", \"peak_rss_delta_kb\": " << u.peak_rss_delta_kb;
+            if (u.counters) out << ", \"counters\": " << counters_json(*u.counters);
+            out << "}";
+        }
+        if (r.bench) {
+            const auto& b = *r.bench;
+            out << ", \"bench\": {\"iterations\": " << b.iterations
+                << ", \"mean_ns\": " << b.mean_ns
+                << ", \"median_ns\": " << b.median_ns
+                << ", \"stddev_ns\": " << b.stddev_ns
+                << ", \"min_ns\": " << b.min_ns
+                << ", \"items_per_second\": " << b.items_per_second
+                << ", \"bytes_per_second\": " << b.bytes_per_second
+                << ", \"samples_ns\": [";
+            for (std::size_t i = 0; i < b.samples_ns.size(); ++i) {
+                out << (i ? ", " : "") << b.samples_ns[i];
+            }
+            out << "]";
+            if (b.counters) out << ", \"counters\": " << counters_json(*b.counters);
+            out << "}";
+        }
+        out << "}";
+        sep = ",\n";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::string format_trace(const std::vector<TraceEvent>& events, const std::map<std::uint32_t, std::string>& tracks) {
+    std::string out = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    append(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"", default_suite_name, "\"}}");
+    for (const auto& [track, name] : tracks) {
+        append(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": ");
+        append_number(out, track);
+        append(out, ", \"args\": {\"name\": \"");
+        append_json_escaped(out, name);
+        append(out, "\"}},\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": ");
+        append_number(out, track);
+        append(out, ", \"args\": {\"sort_index\": ");
+        append_number(out, track);
+        append(out, "}}");
+    }
+    for (const auto& e : events) {
+        append(out, ",\n{\"name\": \"");
+        append_json_escaped(out, e.name);
+        append(out, "\", \"cat\": \"");
+        append_json_escaped(out, e.category);
+        append(out, e.counter ? "\", \"ph\": \"C\", \"pid\": 1" : "\", \"ph\": \"X\", \"pid\": 1, \"tid\": ");
+        if (!e.counter) append_number(out, e.track);
+        append(out, ", \"ts\": ");
+        append_fixed(out, e.ts_us, 3);
+        if (e.counter) {
+            append(out, ", \"args\": {\"value\": ");
+            char number[32];
+            auto [end, ec] = std::to_chars(number, number + sizeof(number), e.value);
+            append(out, std::string_view(number, static_cast<std::size_t>(end - number)), "}}");
+        } else {
+            append(out, ", \"dur\": ");
+            append_fixed(out, e.value, 3);
+            if (!e.args.empty()) append(out, ", \"args\": {", e.args, "}");
+            append(out, "}");
+        }
+    }
+    append(out, "\n]}\n");
+    return out;
+}
+
+bool write_trace(const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    std::string json = format_trace(detail::collect_trace(), detail::trace_track_names());
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(out);
+}
+
+void parse_environment() {
+    if (const char* jobs = std::getenv("MT_JOBS"); jobs && *jobs) {
+        test_jobs = parse_jobs(jobs);
+    }
+    if (const char* total = std::getenv("GTEST_TOTAL_SHARDS")) {
+        total_shards = parse_int(total, -1);
+    }
+    if (const char* index = std::getenv("GTEST_SHARD_INDEX")) {
+        shard_index = parse_int(index, -1);
+    }
+    if (const char* status = std::getenv("GTEST_SHARD_STATUS_FILE")) {
+        shard_status_file = status;
+    }
+    if (const char* balance = std::getenv("MT_SHARD_BALANCE")) {
+        shard_balance = parse_shard_balance(balance);
+    }
+    if (const char* timings = std::getenv("MT_TIMINGS")) {
+        timings_path = timings;
+    }
+    if (const char* isolate = std::getenv("MT_ISOLATE"); isolate && *isolate) {
+        isolate_tests = std::string_view(isolate) != "0";
+    }
+    if (const char* perf = std::getenv("MT_PERF_COUNTERS"); perf && *perf) {
+        perf_counters_enabled = std::string_view(perf) != "0";
+    }
+    if (const char* coordinator = std::getenv("MT_COORDINATOR")) {
+        coordinator_address = coordinator;
+    }
+    if (const char* agent = std::getenv("MT_AGENT")) {
+        agent_address = agent;
+    }
+    if (const char* trace = std::getenv("MT_TRACE")) {
+        trace_output_path = trace;
+    }
+    if (const char* fast = std::getenv("GTEST_FAIL_FAST"); fast && *fast) {
+        fail_fast = std::string_view(fast) != "0";
+    }
+    if (const char* repeat = std::getenv("GTEST_REPEAT")) {
+        repeat_count = parse_int(repeat, repeat_count);
+    }
+    if (const char* shuffle = std::getenv("GTEST_SHUFFLE"); shuffle && *shuffle) {
+        shuffle_tests = std::string_view(shuffle) != "0";
+    }
+    if (const char* seed = std::getenv("GTEST_RANDOM_SEED")) {
+        random_seed = static_cast<std::uint32_t>(std::max(0, parse_int(seed, 0)));
+    }
+    if (const char* cap = std::getenv("MT_MAX_FAILURES_PER_TEST")) {
+        max_failures_per_test = static_cast<std::size_t>(std::max(0, parse_int(cap, 100)));
+    }
+    if (const char* limit = std::getenv("MT_TIMEOUT")) {
+        test_timeout = std::chrono::milliseconds(std::max(0, parse_int(limit, 0)));
+    }
+}
+
+void parse_args(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        
+        // Support both --mt_filter and --gtest_filter for compatibility
+        if (arg.starts_with("--mt_filter=")) {
+            test_filter_pattern = arg.substr(12);
+            test_filter.compile(test_filter_pattern);
+        } else if (arg.starts_with("--gtest_filter=")) {
+            test_filter_pattern = arg.substr(15);
+            test_filter.compile(test_filter_pattern);
+        } else if (arg.starts_with("--mt_output=xml:")) {
+            xml_output_path = arg.substr(16);
+        } else if (arg.starts_with("--gtest_output=xml:")) {
+            xml_output_path = arg.substr(19);
+        } else if (arg.starts_with("--mt_output=json:")) {
+            json_output_path = arg.substr(17);
+        } else if (arg.starts_with("--gtest_output=json:")) {
+            json_output_path = arg.substr(20);
+        } else if (arg.starts_with("--mt_output=jsonl:")) {
+            jsonl_output = arg.substr(18);
+        } else if (arg.starts_with("--mt_trace=")) {
+            trace_output_path = arg.substr(11);
+        } else if (arg == "--mt_bench") {
+            bench_enabled = true;
+        } else if (arg.starts_with("--mt_bench_out=")) {
+            bench_out_path = arg.substr(15);
+            bench_enabled = true;
+        } else if (arg.starts_with("--mt_bench_compare=")) {
+            bench_compare_path = arg.substr(19);
+            bench_enabled = true;
+        } else if (arg.starts_with("--mt_bench_threshold=")) {
+            bench_threshold_pct = std::strtod(arg.c_str() + 21, nullptr);
+        } else if (arg.starts_with("--mt_bench_alpha=")) {
+            bench_alpha = std::strtod(arg.c_str() + 17, nullptr);
+        } else if (arg.starts_with("--mt_bench_min_time=")) {
+            bench_min_time_ms = std::strtod(arg.c_str() + 20, nullptr);
+        } else if (arg.starts_with("--mt_bench_warmup=")) {
+            bench_warmup_ms = std::strtod(arg.c_str() + 18, nullptr);
+        } else if (arg.starts_with("--mt_bench_repetitions=")) {
+            bench_repetitions = parse_int(std::string_view(arg).substr(23), bench_repetitions);
+        } else if (arg.starts_with("--mt_timeout=")) {
+            test_timeout = std::chrono::milliseconds(std::max(0, parse_int(std::string_view(arg).substr(13), 0)));
+        } else if (arg.starts_with("--mt_jobs=")) {
+            test_jobs = parse_jobs(std::string_view(arg).substr(10));
+        } else if (arg.starts_with("--mt_shard_balance=")) {
+            shard_balance = parse_shard_balance(std::string_view(arg).substr(19));
+        } else if (arg.starts_with("--mt_timings=")) {
+            timings_path = arg.substr(13);
+        } else if (arg.starts_with("--gtest_repeat=") || arg.starts_with("--mt_repeat=")) {
+            repeat_count = parse_int(std::string_view(arg).substr(arg.find('=') + 1), 1);
+        } else if (arg == "--mt_until_fail") {
+            until_fail = true;
+        } else if (arg == "--gtest_shuffle" || arg == "--mt_shuffle") {
+            shuffle_tests = true;
+        } else if (arg.starts_with("--gtest_random_seed=") || arg.starts_with("--mt_random_seed=")) {
+            random_seed = static_cast<std::uint32_t>(std::max(0, parse_int(std::string_view(arg).substr(arg.find('=') + 1), 0)));
+        } else if (arg.starts_with("--mt_property_cases=")) {
+            property_cases = static_cast<std::size_t>(std::max(1, parse_int(std::string_view(arg).substr(20), 100)));
+        } else if (arg.starts_with("--mt_property_seed=")) {
+            property_seed = std::strtoull(arg.c_str() + 19, nullptr, 10);
+        } else if (arg.starts_with("--mt_property_jobs=")) {
+            property_jobs = static_cast<unsigned>(std::max(0, parse_int(std::string_view(arg).substr(19), 0)));
+        } else if (arg.starts_with("--mt_stress=")) {
+            stress_threads = static_cast<unsigned>(std::max(1, parse_int(std::string_view(arg).substr(12), 1)));
+        } else if (arg.starts_with("--mt_max_failures_per_test=")) {
+            max_failures_per_test = static_cast<std::size_t>(std::max(0, parse_int(std::string_view(arg).substr(27), 100)));
+        } else if (arg == "--mt_fail_fast" || arg == "--gtest_fail_fast") {
+            fail_fast = true;
+        } else if (arg == "--mt_isolate") {
+            isolate_tests = true;
+        } else if (arg.starts_with("--mt_coordinator=")) {
+            coordinator_address = arg.substr(17);
+        } else if (arg.starts_with("--mt_agent=")) {
+            agent_address = arg.substr(11);
+        } else if (arg == "--mt_perf_counters") {
+            perf_counters_enabled = true;
+        } else if (arg == "--mt_instrument") {
+            instrument_enabled = true;
+        } else if (arg.starts_with("--mt_instrument_top=")) {
+            instrument_enabled = true;
+            instrument_top = parse_int(std::string_view(arg).substr(20), instrument_top);
+        } else if (arg == "--mt_xml_stream") {
+            xml_stream = true;
+        } else if (arg == "--mt_reporter=quiet") {
+            console_mode = ConsoleMode::QUIET;
+        } else if (arg == "--mt_reporter=console") {
+            console_mode = ConsoleMode::NORMAL;
+        } else if (arg == "--mt_no_color" || arg == "--gtest_color=no") {
+            use_colors = false;
+        } else if (arg == "--mt_list_tests" || arg == "--gtest_list_tests") {
+            // List all tests in Google Test format for CMake's gtest_discover_tests
+            // Format: SuiteName.\n  TestName\n
+            std::string listing;
+            append(listing, default_suite_name, ".\n");
+            for (const auto& t : get_tests()) {
+                append(listing, "  ", t.name, detail::CaseSuffix(t).view(), "\n");
+            }
+            std::cout.write(listing.data(), static_cast<std::streamsize>(listing.size()));
+            show_help_only = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "ModernTest Options:\n"
+                      << "  --mt_filter=PATTERN      Run tests matching glob pattern (POS1:POS2-NEG1:NEG2)\n"
+                      << "  --gtest_filter=PATTERN   (alias for --mt_filter)\n"
+                      << "  --mt_output=xml:FILE     Write JUnit XML results to FILE\n"
+                      << "  --gtest_output=xml:FILE  (alias for --mt_output)\n"
+                      << "  --mt_instrument          Record CPU time, allocations and peak RSS per test\n"
+                      << "  --mt_instrument_top=N    Tests listed in the slowest/heaviest summary (default 5)\n"
+                      << "  --mt_perf_counters       Count cycles, instructions, cache and branch misses per benchmark\n"
+                      << "                           iteration, and per test with --mt_instrument (Linux perf_event)\n"
+                      << "  --mt_xml_stream          Append each XML test case as it finishes (crash-safe)\n"
+                      << "  --mt_output=json:FILE    Write JSON results to FILE\n"
+                      << "  --mt_output=jsonl:FILE   Stream one JSON event per line to FILE (or jsonl:fd:N)\n"
+                      << "  --mt_trace=FILE          Write a Chrome trace (chrome://tracing, Perfetto) of the run to FILE\n"
+                      << "  --mt_bench               Measure BENCH entries (otherwise run once as smoke tests)\n"
+                      << "  --mt_bench_min_time=MS   Minimum duration of one repetition (default 100)\n"
+                      << "  --mt_bench_warmup=MS     Untimed warmup per benchmark (default 50)\n"
+                      << "  --mt_bench_repetitions=N Timed repetitions per benchmark (default 5)\n"
+                      << "  --mt_bench_out=FILE      Write a benchmark baseline to FILE (implies --mt_bench)\n"
+                      << "  --mt_bench_compare=FILE  Fail benchmarks that regressed against baseline FILE\n"
+                      << "  --mt_bench_threshold=PCT Median slowdown tolerated before failing (default 5)\n"
+                      << "  --mt_bench_alpha=P       Significance level of the Mann-Whitney U test (default 0.05)\n"
+                      << "  --mt_jobs=N              Run tests on N worker threads (0/auto: all cores)\n"
+                      << "  --mt_timeout=MS          Fail a test that runs longer than MS (ends the run unless isolated)\n"
+                      << "  --mt_fail_fast           Stop after the first failure; report the rest as skipped\n"
+                      << "  --mt_max_failures_per_test=N\n"
+                      << "                           Failures recorded per test; later ones are only counted (default 100, 0: no cap)\n"
+                      << "  --gtest_repeat=N         Run the selected tests N times (negative: forever)\n"
+                      << "  --mt_until_fail          Repeat until an iteration fails (bounded by --gtest_repeat)\n"
+                      << "  --gtest_shuffle          Randomize test order each iteration\n"
+                      << "  --gtest_random_seed=S    Seed for --gtest_shuffle (default: time based)\n"
+                      << "  --mt_stress=N            Run each test body on N threads at once\n"
+                      << "  --mt_property_cases=N    Generated cases per PROPERTY (default 100)\n"
+                      << "  --mt_property_seed=S     Replay PROPERTY inputs from seed S\n"
+                      << "  --mt_property_jobs=N     Threads per PROPERTY (0: cores left over by --mt_jobs)\n"
+                      << "  --mt_isolate             Run tests in reusable child processes; survive crashes (POSIX)\n"
+                      << "  --mt_coordinator=H:P     Serve the selected tests to agents connecting on H:P (POSIX)\n"
+                      << "  --mt_agent=H:P           Run tests pulled from the coordinator at H:P, --mt_jobs at a time\n"
+                      << "  --mt_shard_balance=MODE  Shard by 'round_robin' (default) or recorded 'duration'\n"
+                      << "  --mt_timings=FILE        Read/update recorded test durations in FILE (off by default)\n"
+                      << "  --mt_reporter=NAME       Console output: 'console' (default) or 'quiet' (failures + summary)\n"
+                      << "  --mt_no_color            Disable colored output\n"
+                      << "  --gtest_color=no         (alias for --mt_no_color)\n"
+                      << "  --mt_list_tests          List all tests without running\n"
+                      << "  --gtest_list_tests       (alias for --mt_list_tests)\n"
+                      << "  --help, -h               Show this help\n"
+                      << "\n"
+                      << "Environment:\n"
+                      << "  MT_JOBS                  Default for --mt_jobs\n"
+                      << "  MT_TIMEOUT               Default for --mt_timeout\n"
+                      << "  MT_ISOLATE               Set to 1 for --mt_isolate\n"
+                      << "  MT_COORDINATOR           Default for --mt_coordinator\n"
+                      << "  MT_AGENT                 Default for --mt_agent\n"
+                      << "  MT_TRACE                 Default for --mt_trace\n"
+                      << "  MT_PERF_COUNTERS         Set to 1 for --mt_perf_counters\n"
+                      << "  MT_MAX_FAILURES_PER_TEST Default for --mt_max_failures_per_test\n"
+                      << "  MT_SHARD_BALANCE         Default for --mt_shard_balance\n"
+                      << "  MT_TIMINGS               Default for --mt_timings\n"
+                      << "  GTEST_TOTAL_SHARDS       Split the filtered tests into this many shards\n"
+                      << "  GTEST_SHARD_INDEX        Run only the shard with this index\n"
+                      << "  GTEST_SHARD_STATUS_FILE  Touched to acknowledge the sharding protocol\n";
+            show_help_only = true;
+        }
+    }
+}
+
+// --- 5. REPORTERS ---
+namespace {
+// The GoogleTest-style console log. Each test is formatted into a reused
+// buffer and written with a single write, so parallel runs never interleave.
+class ConsoleReporter : public Reporter {
+public:
+    void run_started(const RunInfo& info) override {
+        append(buf_, GREEN(), "[==========]", RESET(), " Running ");
+        append_number(buf_, static_cast<long long>(info.to_run));
+        append(buf_, " test(s) from ");
+        append_number(buf_, static_cast<long long>(info.registered));
+        append(buf_, " registered");
+        if (info.jobs > 1) {
+            append(buf_, " on ");
+            append_number(buf_, info.jobs);
+            append(buf_, " workers");
+        }
+        if (info.total_shards > 1) {
+            append(buf_, " (shard ");
+            append_number(buf_, info.shard_index);
+            append(buf_, " of ");
+            append_number(buf_, info.total_shards);
+            append(buf_, ")");
+        }
+        append(buf_, ".\n");
+        flush();
+    }
+
+    void test_finished(const TestResult& r) override {
+        if (r.skipped) {
+            append(buf_, YELLOW(), "[ SKIPPED  ]", RESET(), " ", r.name, "\n");
+            flush();
+            return;
+        }
+        append(buf_, "[ RUN      ] ", r.name, "\n");
+        append_bench(r);
+        if (!r.bench && r.resources && r.resources->counters) {
+            append(buf_, GRAY(), "[ COUNTERS ] ", format_counters(*r.resources->counters), RESET(), "\n");
+        }
+        append_failures(r);
+        if (r.passed) append(buf_, GREEN(), "[       OK ]", RESET(), " ", r.name);
+        else          append(buf_, RED(), "[   FAILED ]", RESET(), " ", r.name);
+        append(buf_, GRAY(), " (");
+        append_number(buf_, static_cast<long long>(r.duration_ms));
+        append(buf_, " ms)", RESET(), "\n");
+        flush();
+    }
+
+    void run_finished(const RunSummary& s) override {
+        append(buf_, GREEN(), "[==========]", RESET(), " ");
+        append_number(buf_, s.passed + s.failed);
+        append(buf_, " test(s) ran. ", GRAY(), "(");
+        append_number(buf_, static_cast<long long>(s.total_ms));
+        append(buf_, " ms total)", RESET(), "\n");
+
+        if (s.passed > 0) {
+            append(buf_, GREEN(), "[  PASSED  ]", RESET(), " ");
+            append_number(buf_, s.passed);
+            append(buf_, " test(s).\n");
+        }
+        if (s.skipped > 0) {
+            append(buf_, YELLOW(), "[ SKIPPED  ]", RESET(), " ");
+            append_number(buf_, s.skipped);
+            append(buf_, " test(s).\n");
+        }
+        if (s.failed > 0) {
+            append(buf_, RED(), "[  FAILED  ]", RESET(), " ");
+            append_number(buf_, s.failed);
+            append(buf_, " test(s):\n");
+            for (const auto& r : s.results) {
+                if (!r.skipped && !r.passed) append(buf_, RED(), "             ", r.name, RESET(), "\n");
+            }
+        }
+        append_resource_summary(s);
+        flush();
+    }
+
+protected:
+    void append_failures(const TestResult& r) {
+        // IDE-clickable format: file:line: error: message
+        for (const auto& f : r.failures) {
+            append(buf_, "\t", f.file, ":");
+            append_number(buf_, f.line);
+            append(buf_, ": ", RED(), "error: ", RESET(), f.message, "\n");
+            if (f.hits > 1) {
+                append(buf_, GRAY(), "\t  failed ");
+                append_number(buf_, static_cast<long long>(f.hits));
+                append(buf_, " times here", f.recent.empty() ? "" : "; latest:", RESET(), "\n");
+                for (const auto& m : f.recent) append(buf_, "\t    ", m, "\n");
+            }
+        }
+    }
+
+    // Top-N tables for --mt_instrument runs.
+    void append_resource_summary(const RunSummary& s) {
+        std::vector<const TestResult*> measured;
+        for (const auto& r : s.results) {
+            if (r.resources) measured.push_back(&r);
+        }
+        if (measured.empty() || instrument_top <= 0) return;
+        auto n = std::min(measured.size(), static_cast<std::size_t>(instrument_top));
+
+        auto table = [&](std::string_view title, auto heavier) {
+            std::partial_sort(measured.begin(), measured.begin() + static_cast<std::ptrdiff_t>(n), measured.end(), heavier);
+            append(buf_, GRAY(), "[ RESOURCES] ", RESET(), title, "\n");
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto& r = *measured[i];
+                const auto& u = *r.resources;
+                append(buf_, "             ");
+                append_fixed(buf_, r.duration_ms, 2);
+                append(buf_, " ms  cpu ");
+                append_fixed(buf_, u.user_cpu_ms, 2);
+                append(buf_, "+");
+                append_fixed(buf_, u.system_cpu_ms, 2);
+                append(buf_, " ms  ");
+                append_number(buf_, static_cast<long long>(u.allocations));
+                append(buf_, " allocs  ");
+                append_number(buf_, static_cast<long long>(u.allocated_bytes / 1024));
+                append(buf_, " KiB  rss +");
+                append_number(buf_, static_cast<long long>(u.peak_rss_delta_kb));
+                append(buf_, " KiB  ", r.name, "\n");
+            }
+        };
+        table("Slowest tests:", [](const TestResult* a, const TestResult* b) { return a->duration_ms > b->duration_ms; });
+        table("Heaviest allocators:", [](const TestResult* a, const TestResult* b) {
+            return a->resources->allocated_bytes > b->resources->allocated_bytes;
+        });
+        table("Largest peak RSS growth:", [](const TestResult* a, const TestResult* b) {
+            return a->resources->peak_rss_delta_kb > b->resources->peak_rss_delta_kb;
+        });
+    }
+
+    void append_bench(const TestResult& r) {
+        if (!r.bench) return;
+        append(buf_, "[   BENCH  ] ", format_bench(*r.bench), "\n");
+        if (r.bench->counters) append(buf_, "[ COUNTERS ] ", format_counters(*r.bench->counters), " per iteration\n");
+        if (r.bench->comparison) append(buf_, "[  COMPARE ] ", format_comparison(*r.bench->comparison), "\n");
+    }
+
+    void flush() {
+        std::cout.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        std::cout.flush();
+        buf_.clear();
+    }
+
+    std::string buf_;
+};
+
+// Summary only: prints nothing for passing tests, just the failures and the
+// closing totals.
+class QuietReporter : public ConsoleReporter {
+public:
+    void run_started(const RunInfo&) override {}
+
+    void test_finished(const TestResult& r) override {
+        if (r.skipped || r.passed) return;
+        append_failures(r);
+        append(buf_, RED(), "[   FAILED ]", RESET(), " ", r.name, "\n");
+        flush();
+    }
+};
+
+class XmlReporter : public Reporter {
+public:
+    explicit XmlReporter(std::string path) : path_(std::move(path)) {}
+
+    void run_finished(const RunSummary& s) override {
+        write_junit_xml(path_, s.results, s.total_ms);
+        std::cout << GRAY() << "[   INFO   ] XML results written to: " << path_ << RESET() << "\n";
+    }
+
+private:
+    std::string path_;
+};
+
+// Streams JUnit XML (--mt_xml_stream): each <testcase> is appended as soon
+// as its test finishes, followed by the closing tags, and the aggregate
+// counts in the fixed-width header are rewritten in place. The file is
+// well-formed after every test, so a crash or a killed job still leaves
+// the results so far, and nothing is held in memory to write it.
+// Test cases appear in completion order.
+class StreamingXmlReporter : public Reporter {
+public:
+    explicit StreamingXmlReporter(std::string path) : path_(std::move(path)) {}
+
+    void run_started(const RunInfo&) override {
+        out_.open(path_, std::ios::in | std::ios::out | std::ios::trunc);
+        if (!out_) return;
+        start_ = std::chrono::high_resolution_clock::now();
+        write_header(0.0);
+        body_end_ = out_.tellp();
+        finish_document();
+    }
+
+    void test_finished(const TestResult& r) override {
+        if (!out_) return;
+        tests_++;
+        if (r.skipped) skipped_++;
+        else if (!r.passed) failures_++;
+
+        out_.seekp(body_end_);
+        write_junit_testcase(out_, r);
+        body_end_ = out_.tellp();
+        finish_document();
+        write_header(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_).count());
+    }
+
+    void run_finished(const RunSummary& s) override {
+        if (!out_) return;
+        write_header(s.total_ms);
+        out_.close();
+        std::cout << GRAY() << "[   INFO   ] XML results written to: " << path_ << RESET() << "\n";
+    }
+
+private:
+    // Padding after the attributes keeps every header line the same length,
+    // so it can be overwritten without moving the body.
+    static constexpr std::size_t line_width = 160;
+
+    void write_header(double total_ms) {
+        std::ostringstream suites, suite;
+        suites << "<testsuites tests=\"" << tests_ << "\" failures=\"" << failures_
+               << "\" skipped=\"" << skipped_ << "\" time=\"" << (total_ms / 1000.0) << "\"";
+        suite << "  <testsuite name=\"" << default_suite_name << "\" tests=\"" << tests_ << "\" failures=\"" << failures_
+              << "\" skipped=\"" << skipped_ << "\" time=\"" << (total_ms / 1000.0) << "\"";
+        out_.seekp(0);
+        out_ << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" << padded(suites.str()) << padded(suite.str());
+        out_.flush();
+    }
+
+    static std::string padded(std::string line) {
+        if (line.size() + 2 < line_width) line.append(line_width - 2 - line.size(), ' ');
+        line += ">\n";
+        return line;
+    }
+
+    void finish_document() {
+        out_ << "  </testsuite>\n</testsuites>\n";
+        out_.flush();
+    }
+
+    std::string path_;
+    std::fstream out_;
+    std::streampos body_end_{};
+    std::chrono::high_resolution_clock::time_point start_{};
+    std::size_t tests_ = 0, failures_ = 0, skipped_ = 0;
+};
+
+class JsonReporter : public Reporter {
+public:
+    explicit JsonReporter(std::string path) : path_(std::move(path)) {}
+
+    void run_finished(const RunSummary& s) override {
+        write_json(path_, s.results, s.total_ms);
+        std::cout << GRAY() << "[   INFO   ] JSON results written to: " << path_ << RESET() << "\n";
+    }
+
+private:
+    std::string path_;
+};
+
+// The event stream itself as JSON Lines (--mt_output=jsonl:FILE or
+// jsonl:fd:N) for orchestrators and IDEs: run_start, test_start, one
+// failure event per recorded failure, test_end and run_end. Each event is
+// a single line written and flushed as it happens, so a reader tailing the
+// file or pipe sees tests live.
+class JsonLinesReporter : public Reporter {
+public:
+    explicit JsonLinesReporter(const std::string& target) {
+        if (target.starts_with("fd:")) {
+            int fd = parse_int(target.substr(3), -1);
+#if defined(_WIN32)
+            if (fd >= 0) out_ = _fdopen(_dup(fd), "w");
+#else
+            if (fd >= 0) out_ = fdopen(dup(fd), "w");
+#endif
+        } else {
+            out_ = std::fopen(target.c_str(), "w");
+        }
+        if (!out_) {
+            std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " Cannot open JSON Lines output " << target << "\n";
+        }
+    }
+    ~JsonLinesReporter() override {
+        if (out_) std::fclose(out_);
+    }
+    JsonLinesReporter(const JsonLinesReporter&) = delete;
+    JsonLinesReporter& operator=(const JsonLinesReporter&) = delete;
+
+    void run_started(const RunInfo& info) override {
+        append(line_, "{\"event\": \"run_start\", \"tests\": ");
+        append_number(line_, static_cast<long long>(info.to_run));
+        append(line_, ", \"registered\": ");
+        append_number(line_, static_cast<long long>(info.registered));
+        append(line_, ", \"jobs\": ");
+        append_number(line_, info.jobs);
+        append(line_, ", \"shard_index\": ");
+        append_number(line_, info.shard_index);
+        append(line_, ", \"total_shards\": ");
+        append_number(line_, info.total_shards);
+        append(line_, "}\n");
+        emit();
+    }
+
+    void test_started(const TestResult& r) override {
+        append(line_, "{\"event\": \"test_start\"");
+        append_test(r);
+        append(line_, "}\n");
+        emit();
+    }
+
+    // One event per recorded failure, repeats included, as it happens.
+    void failure_recorded(const TestResult& r, const Failure& f) override {
+        if (f.hits == 1) streamed_[&r]++;
+        append_failure(r, f);
+        emit();
+    }
+
+    void test_finished(const TestResult& r) override {
+        // Entries not streamed live: results from isolated children and
+        // agents, and notes the runner appended after the body.
+        std::size_t streamed = 0;
+        if (auto it = streamed_.find(&r); it != streamed_.end()) {
+            streamed = it->second;
+            streamed_.erase(it);
+        }
+        for (std::size_t i = std::min(streamed, r.failures.size()); i < r.failures.size(); ++i) {
+            append_failure(r, r.failures[i]);
+        }
+        append(line_, "{\"event\": \"test_end\"");
+        append_test(r);
+        append(line_, ", \"status\": \"", r.skipped ? "skipped" : r.passed ? "passed" : "failed", "\", \"duration_ms\": ");
+        append_fixed(line_, r.duration_ms, 3);
+        if (r.resources) {
+            const auto& u = *r.resources;
+            append(line_, ", \"resources\": {\"user_cpu_ms\": ");
+            append_fixed(line_, u.user_cpu_ms, 3);
+            append(line_, ", \"system_cpu_ms\": ");
+            append_fixed(line_, u.system_cpu_ms, 3);
+            append(line_, ", \"allocations\": ");
+            append_number(line_, static_cast<long long>(u.allocations));
+            append(line_, ", \"allocated_bytes\": ");
+            append_number(line_, static_cast<long long>(u.allocated_bytes));
+            append(line_, ", \"peak_rss_delta_kb\": ");
+            append_number(line_, static_cast<long long>(u.peak_rss_delta_kb));
+            if (u.counters) {
+                append(line_, ", \"counters\": ");
+                append_counters_json(line_, *u.counters);
+            }
+            append(line_, "}");
+        }
+        if (r.bench) {
+            append(line_, ", \"bench\": {\"iterations\": ");
+            append_number(line_, static_cast<long long>(r.bench->iterations));
+            append(line_, ", \"median_ns\": ");
+            append_fixed(line_, r.bench->median_ns, 3);
+            append(line_, ", \"stddev_ns\": ");
+            append_fixed(line_, r.bench->stddev_ns, 3);
+            if (r.bench->counters) {
+                append(line_, ", \"counters\": ");
+                append_counters_json(line_, *r.bench->counters);
+            }
+            append(line_, "}");
+        }
+        append(line_, "}\n");
+        emit();
+    }
+
+    void run_finished(const RunSummary& s) override {
+        append(line_, "{\"event\": \"run_end\", \"passed\": ");
+        append_number(line_, s.passed);
+        append(line_, ", \"failed\": ");
+        append_number(line_, s.failed);
+        append(line_, ", \"skipped\": ");
+        append_number(line_, s.skipped);
+        append(line_, ", \"duration_ms\": ");
+        append_fixed(line_, s.total_ms, 3);
+        append(line_, "}\n");
+        emit();
+    }
+
+private:
+    void append_test(const TestResult& r) {
+        append(line_, ", \"name\": \"");
+        append_json_escaped(line_, r.name);
+        append(line_, "\", \"file\": \"");
+        append_json_escaped(line_, r.file);
+        append(line_, "\", \"line\": ");
+        append_number(line_, r.line);
+    }
+
+    void append_failure(const TestResult& r, const Failure& f) {
+        append(line_, "{\"event\": \"failure\", \"name\": \"");
+        append_json_escaped(line_, r.name);
+        append(line_, "\", \"file\": \"");
+        append_json_escaped(line_, f.file);
+        append(line_, "\", \"line\": ");
+        append_number(line_, f.line);
+        append(line_, ", \"message\": \"");
+        append_json_escaped(line_, f.message);
+        append(line_, "\"");
+        if (f.hits > 1) {
+            append(line_, ", \"hits\": ");
+            append_number(line_, static_cast<long long>(f.hits));
+            append(line_, ", \"recent\": [");
+            for (std::size_t m = 0; m < f.recent.size(); ++m) {
+                append(line_, m ? ", \"" : "\"");
+                append_json_escaped(line_, f.recent[m]);
+                append(line_, "\"");
+            }
+            append(line_, "]");
+        }
+        append(line_, "}\n");
+    }
+
+    void emit() {
+        if (out_) {
+            std::fwrite(line_.data(), 1, line_.size(), out_);
+            std::fflush(out_);
+        }
+        line_.clear();
+    }
+
+    std::FILE* out_ = nullptr;
+    std::string line_;
+    std::unordered_map<const TestResult*, std::size_t> streamed_; // failure entries sent live, per running test
+};
+
+// Fans every event out to the active reporters under one lock.
+class ReporterSet : public Reporter {
+public:
+    void add(Reporter& r) { targets_.push_back(&r); }
+
+    void run_started(const RunInfo& info) override {
+        std::lock_guard lock(mutex_);
+        for (auto* r : targets_) r->run_started(info);
+    }
+    void test_started(const TestResult& result) override {
+        std::lock_guard lock(mutex_);
+        for (auto* r : targets_) r->test_started(result);
+    }
+    void failure_recorded(const TestResult& result, const Failure& failure) override {
+        std::lock_guard lock(mutex_);
+        for (auto* r : targets_) r->failure_recorded(result, failure);
+    }
+    void test_finished(const TestResult& result) override {
+        std::lock_guard lock(mutex_);
+        for (auto* r : targets_) r->test_finished(result);
+    }
+    void run_finished(const RunSummary& summary) override {
+        std::lock_guard lock(mutex_);
+        for (auto* r : targets_) r->run_finished(summary);
+    }
+
+    // Ends the run from outside the workers (the timeout watchdog): reports
+    // `last`, closes every reporter with the summary that collect() builds,
+    // and terminates the process. The lock is never released, so a worker
+    // that is still running cannot interleave output with the final report.
+    template <typename Collect>
+    [[noreturn]] void abort_run(const TestResult& last, Collect&& collect, double total_ms, int exit_code) {
+        mutex_.lock();
+        for (auto* r : targets_) r->test_finished(last);
+        std::vector<TestResult> results = collect();
+        RunSummary summary = summarize(results, total_ms);
+        for (auto* r : targets_) r->run_finished(summary);
+        std::cout.flush();
+        std::_Exit(exit_code);
+    }
+
+private:
+    std::vector<Reporter*> targets_;
+    std::mutex mutex_;
+};
+
+// Routes record_failure to the current run's reporters while it lasts.
+class LiveFailures {
+public:
+    explicit LiveFailures(Reporter& report) {
+        target().store(&report, std::memory_order_release);
+        detail::failure_sink.store(&forward, std::memory_order_release);
+    }
+    ~LiveFailures() {
+        detail::failure_sink.store(nullptr, std::memory_order_release);
+        target().store(nullptr, std::memory_order_release);
+    }
+    LiveFailures(const LiveFailures&) = delete;
+    LiveFailures& operator=(const LiveFailures&) = delete;
+
+private:
+    static std::atomic<Reporter*>& target() {
+        static std::atomic<Reporter*> report{nullptr};
+        return report;
+    }
+    static void forward(const TestResult& test, const Failure& failure) {
+        if (auto* report = target().load(std::memory_order_acquire)) report->failure_recorded(test, failure);
+    }
+};
+
+} // namespace
+
+// --- 6. WORKER POOL ---
+// Entry points for PROPERTY bodies, which only see ModernTest.hpp.
+namespace detail {
+void run_parallel(std::size_t count, unsigned jobs, void (*fn)(void* ctx, std::size_t index), void* ctx) {
+    if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency() / std::max(1u, test_jobs));
+    parallel_for_each(count, jobs, [&](std::size_t i, unsigned) { fn(ctx, i); });
+}
+
+std::uint64_t fresh_property_seed() {
+    std::random_device rd;
+    std::uint64_t seed = (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+    return seed ? seed : 1;
+}
+} // namespace detail
+
+// --- 7. EVENT LOOP ---
+namespace detail {
+void schedule_at(EventLoop& loop, std::coroutine_handle<> handle, TestContext* test,
+                 std::chrono::steady_clock::time_point when) {
+    loop.schedule({handle, test}, when);
+}
+
+void post(EventLoop& loop, std::coroutine_handle<> handle, TestContext* test) { loop.post({handle, test}); }
+
+void block_until(std::chrono::steady_clock::time_point when) { std::this_thread::sleep_until(when); }
+
+namespace {
+// Charges one slice of an ASYNC body to its run: CPU time and allocations
+// on the loop thread, growth of the peak RSS and, when the loop has a
+// counter group, hardware counters.
+class SliceMeter {
+public:
+    SliceMeter(AsyncRun& run, const PerfCounterGroup* counters)
+        : run_(run.metered ? &run : nullptr), counters_(counters) {
+        if (!run_) return;
+        start_ = sample_resources();
+        allocs_ = alloc_counters;
+        if (counters_) before_ = counters_->read();
+    }
+    SliceMeter(const SliceMeter&) = delete;
+    SliceMeter& operator=(const SliceMeter&) = delete;
+
+    ~SliceMeter() {
+        if (!run_) return;
+        ResourceSample end = sample_resources();
+        auto& u = run_->resources ? *run_->resources : run_->resources.emplace();
+        u.user_cpu_ms += end.user_cpu_ms - start_.user_cpu_ms;
+        u.system_cpu_ms += end.system_cpu_ms - start_.system_cpu_ms;
+        u.allocations += alloc_counters.count - allocs_.count;
+        u.allocated_bytes += alloc_counters.bytes - allocs_.bytes;
+        if (end.peak_rss_kb > start_.peak_rss_kb) u.peak_rss_delta_kb += end.peak_rss_kb - start_.peak_rss_kb;
+        if (!counters_) return;
+        PerfCounters after = counters_->read();
+        auto& total = u.counters ? *u.counters : u.counters.emplace();
+        for (const auto& [name, field] : perf_counter_fields) {
+            if (!(after.*field) || !(before_.*field)) continue;
+            total.*field = (total.*field).value_or(0.0) + *(after.*field) - *(before_.*field);
+        }
+    }
+
+private:
+    AsyncRun* run_;
+    const PerfCounterGroup* counters_;
+    ResourceSample start_;
+    AllocCounters allocs_;
+    PerfCounters before_;
+};
+
+void record_unhandled(const TestCase& test, std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        record_failure(test.file, test.line, std::string("Unhandled exception: ") + e.what());
+    } catch (...) {
+        record_failure(test.file, test.line, "Unknown exception thrown");
+    }
+}
+} // namespace
+
+void drive_async(std::span<AsyncRun> runs, const std::function<void(std::size_t)>& on_finished) {
+    using Clock = EventLoop::Clock;
+    EventLoop loop;
+    EventLoop* previous = std::exchange(active_loop, &loop);
+    std::unordered_map<const TestContext*, std::size_t> by_context;
+    std::size_t live = runs.size();
+    auto started = Clock::now();
+
+    // One counter group for the whole loop, read around every slice.
+    std::optional<PerfCounterGroup> counters;
+    if (perf_counters_enabled && std::any_of(runs.begin(), runs.end(), [](const auto& r) { return r.metered; })) {
+        counters.emplace();
+        if (counters->available()) counters->enable();
+        else counters.reset();
+    }
+    const PerfCounterGroup* group = counters ? &*counters : nullptr;
+
+    // Wakes next() when another thread requests cancellation; the null
+    // resumption belongs to no run and is dropped.
+    std::stop_callback wake_on_cancel(cancellation_token(), [&loop] { loop.post({}); });
+
+    auto end_run = [&](std::size_t i) {
+        auto& run = runs[i];
+        run.duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        {
+            ContextScope scope(*run.ctx);
+            SliceMeter meter(run, group);
+            run.root = {}; // destroys a body cut short at its suspension point
+        }
+        loop.forget(run.ctx);
+        run.finished = true;
+        live--;
+        on_finished(i);
+    };
+
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        auto& run = runs[i];
+        by_context[run.ctx] = i;
+        ContextScope scope(*run.ctx);
+        SliceMeter meter(run, group);
+        try {
+            run.root = run.test->run_async();
+        } catch (...) {
+            record_unhandled(*run.test, std::current_exception());
+        }
+        if (run.root.handle()) loop.post({run.root.handle(), run.ctx});
+    }
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        if (!runs[i].root.handle()) end_run(i);
+    }
+
+    while (live > 0) {
+        if (cancellation_requested()) {
+            for (std::size_t i = 0; i < runs.size(); ++i) {
+                if (runs[i].finished) continue;
+                runs[i].cancelled = true;
+                end_run(i);
+            }
+            break;
+        }
+        auto until = Clock::time_point::max();
+        for (const auto& run : runs) {
+            if (!run.finished && run.limit.count() > 0) until = std::min(until, started + run.limit);
+        }
+        if (auto r = loop.next(until)) {
+            auto it = by_context.find(r->test);
+            if (it == by_context.end() || runs[it->second].finished) continue;
+            auto& run = runs[it->second];
+            {
+                ContextScope scope(*run.ctx);
+                SliceMeter meter(run, group);
+                r->handle.resume();
+                if (run.root.handle().done()) {
+                    try {
+                        run.root.handle().promise().result();
+                    } catch (...) {
+                        record_unhandled(*run.test, std::current_exception());
+                    }
+                }
+            }
+            if (run.root.handle().done()) end_run(it->second);
+        }
+        auto now = Clock::now();
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            auto& run = runs[i];
+            if (run.finished || run.limit.count() == 0 || now < started + run.limit) continue;
+            {
+                ContextScope scope(*run.ctx);
+                record_failure(run.test->file, run.test->line,
+                    "Timed out after " + std::to_string(run.limit.count()) + " ms");
+            }
+            end_run(i);
+        }
+    }
+    active_loop = previous;
+}
+
+void run_async_body(const TestCase& test) {
+    AsyncRun run;
+    run.test = &test;
+    run.ctx = &current_test();
+    drive_async({&run, 1}, [](std::size_t) {});
+}
+} // namespace detail
+
+// --- 9. SHARDING ---
+TimingMap load_timings(const std::string& path) {
+    TimingMap timings;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line.front() == '#') continue;
+        auto tab = line.find('\t');
+        if (tab == std::string::npos) continue;
+        timings[line.substr(tab + 1)] = std::strtod(line.c_str(), nullptr);
+    }
+    return timings;
+}
+
+bool save_timings(const std::string& path, const TimingMap& timings) {
+#if defined(_WIN32)
+    long pid = _getpid();
+#else
+    long pid = ::getpid();
+#endif
+    std::random_device rd;
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), ".%ld.%08x.tmp", pid, static_cast<unsigned>(rd()));
+    std::string tmp = path + suffix;
+    bool written = false;
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) return false;
+        std::vector<const TimingMap::value_type*> sorted;
+        for (const auto& entry : timings) sorted.push_back(&entry);
+        std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first < b->first; });
+        out << "# moderntest-timings v1\n";
+        for (const auto* entry : sorted) out << entry->second << '\t' << entry->first << '\n';
+        out.close();
+        written = static_cast<bool>(out);
+    }
+    if (written && std::rename(tmp.c_str(), path.c_str()) == 0) return true;
+    // Windows refuses to rename over an existing file
+    if (written && std::remove(path.c_str()) == 0 && std::rename(tmp.c_str(), path.c_str()) == 0) return true;
+    std::remove(tmp.c_str());
+    return false;
+}
+
+// --- 10. ISOLATION ---
+// --mt_isolate runs tests in child processes so a crash fails one test
+// instead of the whole binary. Children are forked once up front and reused;
+// each receives test slots over a pipe and answers with one framed, binary
+// encoded result per test. POSIX only.
+#if !defined(_WIN32)
+namespace {
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+std::string describe_signal(int sig) {
+    static constexpr std::pair<int, const char*> names[] = {
+        {SIGSEGV, "SIGSEGV"}, {SIGABRT, "SIGABRT"}, {SIGBUS, "SIGBUS"}, {SIGFPE, "SIGFPE"},
+        {SIGILL, "SIGILL"},   {SIGKILL, "SIGKILL"}, {SIGTERM, "SIGTERM"}, {SIGTRAP, "SIGTRAP"},
+        {SIGPIPE, "SIGPIPE"}, {SIGSYS, "SIGSYS"},
+    };
+    std::string name = "signal " + std::to_string(sig);
+    for (auto [n, label] : names) {
+        if (n == sig) name = label;
+    }
+    if (const char* text = ::strsignal(sig)) name = name + " (" + text + ")";
+    return name;
+}
+
+class IsolatedPool {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Runs in the child: fills `result` for the test in `slot`.
+    using RunInChild = std::function<void(std::size_t slot, TestResult& result)>;
+
+    IsolatedPool(unsigned workers, RunInChild run) : run_(std::move(run)), workers_(std::max(1u, workers)) {
+        // A child that dies between tests turns the next command into a
+        // write error rather than a SIGPIPE for the whole run.
+        previous_sigpipe_ = std::signal(SIGPIPE, SIG_IGN);
+        std::cout.flush();
+        std::fflush(stdout);
+        for (auto& w : workers_) spawn(w);
+    }
+
+    ~IsolatedPool() {
+        for (auto& w : workers_) retire(w, false);
+        std::signal(SIGPIPE, previous_sigpipe_);
+    }
+
+    IsolatedPool(const IsolatedPool&) = delete;
+    IsolatedPool& operator=(const IsolatedPool&) = delete;
+
+    // Runs every slot in `tasks`, calling started(slot) as it is handed to
+    // a child and done(slot) once results[slot] is filled in. A child that
+    // crashes or overruns limit_of(slot) fails its test and is replaced.
+    template <typename Limit, typename Start, typename Done>
+    void run(const std::vector<std::size_t>& tasks, std::vector<TestResult>& results, Limit&& limit_of, Start&& started,
+             Done&& done) {
+        std::size_t next = 0;
+        std::size_t busy = 0;
+        std::vector<pollfd> fds;
+        std::vector<Worker*> polled;
+
+        bool cancelled = false;
+        while (next < tasks.size() || busy > 0) {
+            if (!cancelled && cancellation_requested()) {
+                // Stop dispatching and pass the request on to running tests.
+                cancelled = true;
+                next = tasks.size();
+                for (auto& w : workers_) {
+                    if (w.busy) ::kill(w.pid, SIGUSR1);
+                }
+            }
+            for (auto& w : workers_) {
+                if (w.busy || next >= tasks.size() || w.pid <= 0) continue;
+                std::size_t slot = tasks[next++];
+                auto limit = limit_of(slot);
+                w.slot = slot;
+                w.started = Clock::now();
+                w.deadline = limit.count() > 0 ? w.started + limit : Clock::time_point::max();
+                w.limit = limit;
+                w.busy = true;
+                busy++;
+                started(slot);
+                auto command = static_cast<std::uint64_t>(slot);
+                if (!write_all(w.commands, reinterpret_cast<const char*>(&command), sizeof(command))) {
+                    lost(w, results, done); // died while idle; its EOF shows up as a write error
+                    busy--;
+                }
+            }
+            if (busy == 0) {
+                // Nothing could be dispatched: fork keeps failing.
+                for (; next < tasks.size(); ++next) {
+                    auto& r = results[tasks[next]];
+                    r.passed = false;
+                    r.failures.push_back({r.file, r.line, "Could not start an isolated worker process", 1, {}});
+                    done(tasks[next]);
+                }
+                break;
+            }
+
+            fds.clear();
+            polled.clear();
+            auto now = Clock::now();
+            auto wait = Clock::duration::max();
+            for (auto& w : workers_) {
+                if (!w.busy) continue;
+                fds.push_back({w.results, POLLIN, 0});
+                polled.push_back(&w);
+                wait = std::min(wait, w.deadline - now);
+            }
+            int timeout_ms = wait == Clock::duration::max() ? -1
+                : static_cast<int>(std::max<std::int64_t>(0,
+                      std::chrono::ceil<std::chrono::milliseconds>(wait).count()));
+            int ready = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+            if (ready < 0 && errno != EINTR) break;
+
+            for (std::size_t i = 0; i < polled.size(); ++i) {
+                Worker& w = *polled[i];
+                if (ready > 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    char chunk[4096];
+                    ssize_t n = ::read(w.results, chunk, sizeof(chunk));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) {
+                        lost(w, results, done);
+                        busy--;
+                        continue;
+                    }
+                    w.inbox.append(chunk, static_cast<std::size_t>(n));
+                    if (deliver(w, results, done)) busy--;
+                } else if (Clock::now() >= w.deadline) {
+                    timed_out(w, results, done);
+                    busy--;
+                }
+            }
+        }
+    }
+
+private:
+    struct Worker {
+        pid_t pid = -1;
+        int commands = -1; // parent -> child: slot numbers
+        int results = -1;  // child -> parent: framed results
+        bool busy = false;
+        std::size_t slot = 0;
+        Clock::time_point started;
+        Clock::time_point deadline;
+        std::chrono::milliseconds limit{0};
+        std::string inbox;
+    };
+
+    void spawn(Worker& w) {
+        int down[2], up[2];
+        if (::pipe(down) != 0) return;
+        if (::pipe(up) != 0) {
+            ::close(down[0]);
+            ::close(down[1]);
+            return;
+        }
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            // Drop every other worker's pipes so their children see EOF
+            // when the parent closes them.
+            for (auto& other : workers_) {
+                if (other.commands >= 0) ::close(other.commands);
+                if (other.results >= 0) ::close(other.results);
+            }
+            ::close(down[1]);
+            ::close(up[0]);
+            serve(down[0], up[1]);
+        }
+        ::close(down[0]);
+        ::close(up[1]);
+        if (pid < 0) {
+            ::close(down[1]);
+            ::close(up[0]);
+            return;
+        }
+        w.pid = pid;
+        w.commands = down[1];
+        w.results = up[0];
+        w.busy = false;
+        w.inbox.clear();
+    }
+
+    [[noreturn]] void serve(int commands, int results) {
+        // The parent's cancellation arrives as SIGUSR1; only the atomic flag
+        // is safe to set from a handler, so the stop token stays unset here.
+        std::signal(SIGUSR1, [](int) { detail::cancel_flag.store(true, std::memory_order_relaxed); });
+        // The parent traces what runs here, and streams its results.
+        detail::stop_trace();
+        detail::failure_sink.store(nullptr, std::memory_order_release);
+        std::uint64_t slot;
+        while (read_all(commands, reinterpret_cast<char*>(&slot), sizeof(slot))) {
+            TestResult result;
+            run_(static_cast<std::size_t>(slot), result);
+            std::cout.flush();
+            std::fflush(stdout);
+            std::string frame = detail::encode_result(slot, result);
+            if (!write_all(results, frame.data(), frame.size())) break;
+        }
+        // Skip static destructors: they belong to the parent's state.
+        std::_Exit(0);
+    }
+
+    void retire(Worker& w, bool kill) {
+        if (w.pid <= 0) return;
+        if (kill) ::kill(w.pid, SIGKILL);
+        ::close(w.commands);
+        ::close(w.results);
+        int status = 0;
+        while (::waitpid(w.pid, &status, 0) < 0 && errno == EINTR) {}
+        w.pid = -1;
+        w.commands = w.results = -1;
+        w.busy = false;
+    }
+
+    // Completes the in-flight test once its whole frame has arrived.
+    template <typename Done>
+    bool deliver(Worker& w, std::vector<TestResult>& results, Done& done) {
+        std::uint32_t length = 0;
+        if (w.inbox.size() < sizeof(length)) return false;
+        std::memcpy(&length, w.inbox.data(), sizeof(length));
+        if (w.inbox.size() < sizeof(length) + length) return false;
+
+        std::uint64_t slot = 0;
+        TestResult decoded;
+        bool ok = detail::decode_result(std::string_view(w.inbox).substr(sizeof(length), length), slot, decoded);
+        w.inbox.clear();
+        w.busy = false;
+        auto& r = results[w.slot];
+        if (!ok || slot != w.slot) {
+            r.passed = false;
+            r.failures.push_back({r.file, r.line, "Malformed result from isolated worker", 1, {}});
+        } else {
+            detail::merge_result(r, std::move(decoded));
+        }
+        done(w.slot);
+        return true;
+    }
+
+    // The child died mid-test: fail the test with the reason and respawn.
+    template <typename Done>
+    void lost(Worker& w, std::vector<TestResult>& results, Done& done) {
+        pid_t pid = w.pid;
+        ::close(w.commands);
+        ::close(w.results);
+        int status = 0;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        w.pid = -1;
+        w.commands = w.results = -1;
+
+        auto& r = results[w.slot];
+        r.passed = false;
+        r.duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - w.started).count();
+        std::string reason = WIFSIGNALED(status) ? "Crashed with " + describe_signal(WTERMSIG(status))
+                           : WIFEXITED(status)   ? "Exited with status " + std::to_string(WEXITSTATUS(status))
+                                                 : std::string("Worker process lost");
+        r.failures.push_back({r.file, r.line, reason, 1, {}});
+        w.busy = false;
+        done(w.slot);
+        spawn(w);
+    }
+
+    template <typename Done>
+    void timed_out(Worker& w, std::vector<TestResult>& results, Done& done) {
+        retire(w, true);
+        auto& r = results[w.slot];
+        r.passed = false;
+        r.duration_ms = static_cast<double>(w.limit.count());
+        r.failures.push_back(
+            {r.file, r.line, "Timed out after " + std::to_string(w.limit.count()) + " ms; worker killed", 1, {}});
+        done(w.slot);
+        spawn(w);
+    }
+
+    RunInChild run_;
+    std::vector<Worker> workers_;
+    void (*previous_sigpipe_)(int) = SIG_DFL;
+};
+} // namespace
+#endif
+
+// --- 11. DISTRIBUTED ---
+#if !defined(_WIN32)
+namespace {
+std::string describe_peer(const sockaddr* addr, socklen_t len) {
+    char host[NI_MAXHOST], port[NI_MAXSERV];
+    if (::getnameinfo(addr, len, host, sizeof(host), port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        return "?";
+    }
+    return std::string(host) + ":" + port;
+}
+
+// Frames are a u32 length followed by the payload, as in isolated runs.
+bool take_frame(std::string& inbox, std::string& payload) {
+    std::uint32_t length = 0;
+    if (inbox.size() < sizeof(length)) return false;
+    std::memcpy(&length, inbox.data(), sizeof(length));
+    if (inbox.size() < sizeof(length) + length) return false;
+    payload.assign(inbox, sizeof(length), length);
+    inbox.erase(0, sizeof(length) + length);
+    return true;
+}
+
+bool send_command(int fd, std::uint64_t command) {
+    return write_all(fd, reinterpret_cast<const char*>(&command), sizeof(command));
+}
+
+// Accepts agents and hands each connection one test at a time. Lives for
+// the whole run_all_tests call, so agents stay connected across
+// --gtest_repeat iterations and are told to quit once it returns.
+class Coordinator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Coordinator(const std::string& address) : fingerprint_(detail::registry_fingerprint(get_tests())) {
+        previous_sigpipe_ = std::signal(SIGPIPE, SIG_IGN);
+        std::string host, port;
+        if (!detail::split_host_port(address, host, port)) {
+            std::cout << RED() << "[  ERROR   ]" << RESET() << " --mt_coordinator expects HOST:PORT, got " << address << "\n";
+            return;
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* found = nullptr;
+        if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0) found = nullptr;
+        for (addrinfo* a = found; a && listener_ < 0; a = a->ai_next) {
+            int fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if (::bind(fd, a->ai_addr, a->ai_addrlen) == 0 && ::listen(fd, 64) == 0) {
+                listener_ = fd;
+            } else {
+                ::close(fd);
+            }
+        }
+        if (found) ::freeaddrinfo(found);
+        if (listener_ < 0) {
+            std::cout << RED() << "[  ERROR   ]" << RESET() << " Cannot listen on " << address << "\n";
+            return;
+        }
+        sockaddr_storage bound{};
+        socklen_t len = sizeof(bound);
+        ::getsockname(listener_, reinterpret_cast<sockaddr*>(&bound), &len);
+        where_ = describe_peer(reinterpret_cast<sockaddr*>(&bound), len);
+        std::cout << GRAY() << "[  COORD   ] Listening for agents on " << where_ << RESET() << "\n" << std::flush;
+    }
+
+    ~Coordinator() {
+        for (auto& a : agents_) {
+            if (a.joined) send_command(a.fd, detail::agent_quit);
+            ::close(a.fd);
+        }
+        if (listener_ >= 0) ::close(listener_);
+        std::signal(SIGPIPE, previous_sigpipe_);
+    }
+
+    Coordinator(const Coordinator&) = delete;
+    Coordinator& operator=(const Coordinator&) = delete;
+
+    bool listening() const { return listener_ >= 0; }
+
+    // Runs every slot in `tasks` on the agents, with IsolatedPool::run's
+    // callbacks. An agent that disconnects or overruns limit_of(slot) fails
+    // its test and is dropped; the others carry on. Once no agent has been
+    // connected for agent_patience, the remaining tests fail.
+    template <typename Limit, typename Start, typename Done>
+    void run(const std::vector<std::size_t>& tasks, const std::vector<const TestCase*>& selected,
+             std::vector<TestResult>& results, Limit&& limit_of, Start&& started, Done&& done) {
+        std::size_t next = 0;
+        std::size_t busy = 0;
+        bool waiting_noted = false;
+        auto alone_since = Clock::now();
+        std::vector<pollfd> fds;
+        std::string payload;
+
+        while (next < tasks.size() || busy > 0) {
+            if (cancellation_requested()) next = tasks.size(); // running tests still report
+            for (auto& a : agents_) {
+                if (!a.joined || a.busy || a.fd < 0 || next >= tasks.size()) continue;
+                std::size_t slot = tasks[next++];
+                if (!send_command(a.fd, selected[slot]->index)) {
+                    next--; // never reached the agent; hand it to another one
+                    drop(a, results, done, busy);
+                    continue;
+                }
+                auto limit = limit_of(slot);
+                a.slot = slot;
+                a.index = selected[slot]->index;
+                a.started = Clock::now();
+                a.deadline = limit.count() > 0 ? a.started + limit : Clock::time_point::max();
+                a.limit = limit;
+                a.busy = true;
+                busy++;
+                started(slot);
+            }
+            std::erase_if(agents_, [](const Agent& a) { return a.fd < 0; });
+            bool alone = std::none_of(agents_.begin(), agents_.end(), [](const Agent& a) { return a.joined; });
+            if (!alone) alone_since = Clock::now();
+            if (alone && !waiting_noted) {
+                std::cout << GRAY() << "[  COORD   ] Waiting for agents on " << where_ << RESET() << "\n" << std::flush;
+                waiting_noted = true;
+            }
+            if (alone && Clock::now() - alone_since >= agent_patience) {
+                for (; next < tasks.size(); ++next) {
+                    auto& r = results[tasks[next]];
+                    r.passed = false;
+                    r.failures.push_back({r.file, r.line, "No agent connected to " + where_ + " within " +
+                        std::to_string(agent_patience.count()) + " s", 1, {}});
+                    done(tasks[next]);
+                }
+                break;
+            }
+
+            fds.clear();
+            fds.push_back({listener_, POLLIN, 0});
+            auto now = Clock::now();
+            auto wait = Clock::duration::max();
+            for (auto& a : agents_) {
+                fds.push_back({a.fd, POLLIN, 0});
+                if (a.busy) wait = std::min(wait, a.deadline - now);
+            }
+            if (alone) wait = std::min<Clock::duration>(wait, alone_since + agent_patience - now);
+            int timeout_ms = wait == Clock::duration::max() ? -1
+                : static_cast<int>(std::max<std::int64_t>(0,
+                      std::chrono::ceil<std::chrono::milliseconds>(wait).count()));
+            int ready = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms);
+            if (ready < 0 && errno != EINTR) break;
+
+            for (std::size_t i = 1; ready > 0 && i < fds.size(); ++i) {
+                Agent& a = agents_[i - 1];
+                if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+                char chunk[4096];
+                ssize_t n = ::read(a.fd, chunk, sizeof(chunk));
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    drop(a, results, done, busy);
+                    continue;
+                }
+                a.inbox.append(chunk, static_cast<std::size_t>(n));
+                while (a.fd >= 0 && take_frame(a.inbox, payload)) {
+                    if (!a.joined) greet(a, payload);
+                    else if (!a.busy) drop(a, results, done, busy); // results nobody asked for
+                    else deliver(a, payload, results, done, busy);
+                }
+            }
+            now = Clock::now();
+            for (auto& a : agents_) {
+                if (a.fd < 0 || !a.busy || now < a.deadline) continue;
+                auto& r = results[a.slot];
+                r.passed = false;
+                r.duration_ms = static_cast<double>(a.limit.count());
+                r.failures.push_back({r.file, r.line, "Timed out after " + std::to_string(a.limit.count()) +
+                                                          " ms on agent " + a.peer + "; agent dropped", 1, {}});
+                a.busy = false;
+                busy--;
+                done(a.slot);
+                ::close(a.fd); // still running the test; its later writes fail
+                a.fd = -1;
+            }
+            if (ready > 0 && (fds[0].revents & POLLIN)) accept_agent();
+            std::erase_if(agents_, [](const Agent& a) { return a.fd < 0; });
+        }
+    }
+
+private:
+    static constexpr std::chrono::seconds agent_patience{60};
+
+    struct Agent {
+        int fd = -1;
+        std::string peer;
+        bool joined = false; // handshake accepted
+        bool busy = false;
+        std::size_t slot = 0;
+        std::uint64_t index = 0;
+        Clock::time_point started;
+        Clock::time_point deadline;
+        std::chrono::milliseconds limit{0};
+        std::string inbox;
+    };
+
+    void accept_agent() {
+        sockaddr_storage addr{};
+        socklen_t len = sizeof(addr);
+        int fd = ::accept(listener_, reinterpret_cast<sockaddr*>(&addr), &len);
+        if (fd < 0) return;
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        Agent a;
+        a.fd = fd;
+        a.peer = describe_peer(reinterpret_cast<sockaddr*>(&addr), len);
+        agents_.push_back(std::move(a));
+    }
+
+    void greet(Agent& a, const std::string& hello) {
+        detail::WireReader r(hello);
+        auto magic = r.get<std::uint32_t>();
+        auto fingerprint = r.get<std::uint64_t>();
+        if (!r.ok() || magic != detail::agent_hello_magic || fingerprint != fingerprint_) {
+            std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " Rejected agent " << a.peer
+                      << ": its tests do not match this binary's\n" << std::flush;
+            send_command(a.fd, detail::agent_rejected);
+            ::close(a.fd);
+            a.fd = -1;
+            return;
+        }
+        a.joined = true;
+        std::cout << GRAY() << "[  COORD   ] Agent " << a.peer << " joined" << RESET() << "\n" << std::flush;
+    }
+
+    template <typename Done>
+    void deliver(Agent& a, const std::string& payload, std::vector<TestResult>& results, Done& done, std::size_t& busy) {
+        std::uint64_t index = 0;
+        TestResult decoded;
+        bool ok = detail::decode_result(payload, index, decoded);
+        auto& r = results[a.slot];
+        if (!ok || index != a.index) {
+            r.passed = false;
+            r.failures.push_back({r.file, r.line, "Malformed result from agent " + a.peer, 1, {}});
+        } else {
+            detail::merge_result(r, std::move(decoded));
+        }
+        a.busy = false;
+        busy--;
+        done(a.slot);
+    }
+
+    // Closes the connection; a test it was running fails.
+    template <typename Done>
+    void drop(Agent& a, std::vector<TestResult>& results, Done& done, std::size_t& busy) {
+        if (a.busy) {
+            auto& r = results[a.slot];
+            r.passed = false;
+            r.duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - a.started).count();
+            r.failures.push_back({r.file, r.line, "Agent " + a.peer + " disconnected while running this test", 1, {}});
+            a.busy = false;
+            busy--;
+            done(a.slot);
+        } else if (a.joined) {
+            std::cout << GRAY() << "[  COORD   ] Agent " << a.peer << " left" << RESET() << "\n" << std::flush;
+        }
+        ::close(a.fd);
+        a.fd = -1;
+    }
+
+    std::uint64_t fingerprint_;
+    int listener_ = -1;
+    std::string where_;
+    std::vector<Agent> agents_;
+    void (*previous_sigpipe_)(int) = SIG_DFL;
+};
+
+Coordinator* active_coordinator = nullptr;
+
+// Retries for a while so agents can be started before the coordinator.
+int connect_to(const std::string& host, const std::string& port, std::chrono::seconds patience,
+               const std::atomic<bool>& stop) {
+    auto give_up = std::chrono::steady_clock::now() + patience;
+    while (!stop.load()) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        int fd = -1;
+        if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) == 0) {
+            for (addrinfo* a = found; a && fd < 0; a = a->ai_next) {
+                fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+            ::freeaddrinfo(found);
+        }
+        if (fd >= 0 || std::chrono::steady_clock::now() >= give_up) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds{200});
+    }
+    return -1;
+}
+} // namespace
+#endif
+
+int run_agent(const std::string& address) {
+#if defined(_WIN32)
+    std::cout << RED() << "[  ERROR   ]" << RESET() << " --mt_agent needs POSIX sockets.\n";
+    return 1;
+#else
+    std::string host, port;
+    if (!detail::split_host_port(address, host, port) || host.empty()) {
+        std::cout << RED() << "[  ERROR   ]" << RESET() << " --mt_agent expects HOST:PORT, got " << address << "\n";
+        return 1;
+    }
+    std::vector<const TestCase*> by_index(get_tests().size());
+    for (const auto& t : get_tests()) by_index[t.index] = &t;
+
+    detail::WireWriter hello;
+    hello.put<std::uint32_t>(sizeof(std::uint32_t) + sizeof(std::uint64_t));
+    hello.put(detail::agent_hello_magic);
+    hello.put(detail::registry_fingerprint(get_tests()));
+
+    auto previous_sigpipe = std::signal(SIGPIPE, SIG_IGN);
+    std::atomic<std::size_t> ran{0};
+    // Once one connection is told to quit the run is over: connections
+    // still dialing stop, and ones the coordinator never served are not
+    // failures.
+    std::atomic<bool> quit_seen{false};
+    std::atomic<bool> lost{false};
+    auto serve = [&] {
+        int fd = connect_to(host, port, std::chrono::seconds{30}, quit_seen);
+        if (fd < 0) {
+            lost = true;
+            return;
+        }
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        bool quit = false;
+        std::uint64_t command = 0;
+        if (write_all(fd, hello.data().data(), hello.data().size())) {
+            while (read_all(fd, reinterpret_cast<char*>(&command), sizeof(command))) {
+                if (command == detail::agent_quit) {
+                    quit = true;
+                    break;
+                }
+                if (command >= by_index.size()) break; // agent_rejected
+                TestResult result;
+                run_test(*by_index[command], result);
+                std::string frame = detail::encode_result(command, result);
+                if (!write_all(fd, frame.data(), frame.size())) break;
+                ran++;
+            }
+        }
+        ::close(fd);
+        if (quit) quit_seen = true;
+        else lost = true;
+    };
+
+    std::cout << GRAY() << "[  AGENT   ] Pulling tests from " << address << " on " << std::max(1u, test_jobs)
+              << " connection(s)" << RESET() << "\n";
+    std::vector<std::thread> connections;
+    for (unsigned i = 1; i < std::max(1u, test_jobs); ++i) connections.emplace_back(serve);
+    serve();
+    for (auto& t : connections) t.join();
+    std::signal(SIGPIPE, previous_sigpipe);
+    const bool failed = lost && !quit_seen;
+
+    std::cout << (failed ? RED() : GRAY()) << "[  AGENT   ] Ran " << ran.load() << " test(s)"
+              << (failed ? "; lost or rejected by the coordinator" : "") << RESET() << "\n";
+    return failed ? 1 : 0;
+#endif
+}
+
+// --- 12. RUNNER ---
+void request_cancellation() {
+    if (!detail::cancel_flag.exchange(true)) detail::cancel_source.request_stop();
+}
+
+namespace {
+void collect_failures(const TestCase& test, TestContext& ctx, TestResult& result) {
+    if (ctx.suppressed > 0) {
+        ctx.failures.push_back({test.file, test.line, std::to_string(ctx.suppressed) +
+            " more failure(s) not recorded (--mt_max_failures_per_test=" + std::to_string(max_failures_per_test) + ")",
+            1, {}});
+    }
+    result.failures = std::move(ctx.failures);
+    result.passed = !ctx.failed;
+}
+
+std::string trace_args(const TestResult& result) {
+    std::string args = result.passed ? "\"passed\": true" : "\"passed\": false";
+    if (!result.failures.empty()) {
+        append(args, ", \"failures\": ");
+        append_number(args, static_cast<long long>(result.failures.size()));
+    }
+    return args;
+}
+} // namespace
+
+void run_test(const TestCase& test, TestResult& result) {
+    TestContext ctx;
+    ctx.file = test.file;
+    ctx.live = &result;
+    ContextScope scope(ctx);
+
+    std::optional<ResourceProbe> probe;
+    if (instrument_enabled) probe.emplace();
+    auto test_start = std::chrono::high_resolution_clock::now();
+
+    if (stress_threads > 1 && test.kind == TestKind::TEST) {
+        detail::run_stressed(test, ctx, result);
+    } else {
+        detail::invoke_test_body(test, result);
+    }
+
+    if (result.bench) {
+        auto base = bench_baseline.find(test.display_name());
+        if (base != bench_baseline.end()) {
+            result.bench->comparison = compare_bench(*result.bench, base->second);
+            if (result.bench->comparison->regressed) {
+                detail::record_failure(test.file, test.line,
+                    "Benchmark regressed: " + format_comparison(*result.bench->comparison));
+            }
+        }
+    }
+
+    auto test_end = std::chrono::high_resolution_clock::now();
+    if (probe) result.resources = probe->finish();
+    result.duration_ms = std::chrono::duration<double, std::milli>(test_end - test_start).count();
+    collect_failures(test, ctx, result);
+    if (detail::tracing()) {
+        detail::record_trace_span(test.display_name(), "test", test_start, test_end, 0, trace_args(result));
+    }
+}
+
+void print_tallies(int iterations) {
+    std::string out;
+    std::vector<const TestTally*> failing;
+    for (const auto& t : get_tallies()) {
+        if (t.failures > 0) failing.push_back(&t);
+    }
+    append(out, GRAY(), "[  TALLY   ] ", RESET());
+    append_number(out, iterations);
+    append(out, " iteration(s)");
+    if (failing.empty()) {
+        append(out, ", no test failed.\n");
+    } else {
+        append(out, ", ");
+        append_number(out, static_cast<long long>(failing.size()));
+        append(out, " test(s) failed at least once:\n");
+        for (const auto* t : failing) {
+            append(out, t->failures < t->runs ? YELLOW() : RED(), "             ");
+            append_number(out, t->failures);
+            append(out, "/");
+            append_number(out, t->runs);
+            append(out, " failed  ", t->name, t->failures < t->runs ? "  (flaky)" : "", RESET(), "\n");
+        }
+    }
+    std::cout << out;
+}
+
+int run_iteration(int iteration) {
+    auto& tests = get_tests();
+    auto& results = get_results();
+    results.clear();
+    
+    // Check for ONLY
+    bool has_only = std::any_of(tests.begin(), tests.end(), 
+        [](const auto& t) { return t.status == TestStatus::ONLY; });
+
+    TimingMap timings;
+    if (!timings_path.empty()) timings = load_timings(timings_path);
+    if (!bench_compare_path.empty()) {
+        bench_baseline = load_bench_baseline(bench_compare_path);
+        if (bench_baseline.empty()) {
+            std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " No benchmarks found in baseline "
+                      << bench_compare_path << "\n";
+        }
+    }
+
+    std::vector<const TestCase*> filtered;
+    for (const auto& t : tests) {
+        if (matches_test_filters(t)) filtered.push_back(&t);
+    }
+
+    // Shards partition the filtered list, skipped tests included, so every
+    // test is reported by exactly one shard.
+    std::vector<bool> in_shard(filtered.size(), true);
+    if (total_shards > 1) {
+        std::vector<double> cost;
+        if (shard_balance == ShardBalance::DURATION) {
+            std::vector<std::string> owned;
+            for (const auto* t : filtered) owned.push_back(t->display_name());
+            cost = estimate_costs(std::vector<std::string_view>(owned.begin(), owned.end()), timings);
+        }
+        in_shard = assign_shard(filtered.size(), total_shards, shard_index, shard_balance, cost);
+    }
+
+    // Results are pre-sized in registration order; workers fill their own slot,
+    // so the report stays deterministic regardless of scheduling.
+    std::vector<const TestCase*> selected;
+    std::vector<std::size_t> runnable;
+    for (std::size_t i = 0; i < filtered.size(); ++i) {
+        if (!in_shard[i]) continue;
+        const auto& t = *filtered[i];
+        if (t.status != TestStatus::SKIP && (!has_only || t.status == TestStatus::ONLY)) {
+            runnable.push_back(selected.size());
+        }
+        selected.push_back(&t);
+    }
+    results.resize(selected.size());
+    for (std::size_t i = 0; i < selected.size(); ++i) {
+        results[i].name = selected[i]->display_name();
+        results[i].file = selected[i]->file;
+        results[i].line = selected[i]->line;
+        results[i].skipped = true;
+    }
+    for (std::size_t slot : runnable) results[slot].skipped = false;
+
+    ConsoleReporter console;
+    QuietReporter quiet;
+    std::optional<XmlReporter> xml;
+    std::optional<StreamingXmlReporter> xml_streaming;
+    std::optional<JsonReporter> json;
+    ReporterSet report;
+    report.add(console_mode == ConsoleMode::QUIET ? static_cast<Reporter&>(quiet) : console);
+    if (!xml_output_path.empty()) {
+        if (xml_stream) report.add(xml_streaming.emplace(xml_output_path));
+        else report.add(xml.emplace(xml_output_path));
+    }
+    if (!json_output_path.empty()) report.add(json.emplace(json_output_path));
+    std::optional<JsonLinesReporter> jsonl;
+    if (!jsonl_output.empty()) report.add(jsonl.emplace(jsonl_output));
+    for (auto& r : custom_reporters()) report.add(*r);
+    LiveFailures live(report);
+
+    // When every consumer of failure details streams, results keep only
+    // their summary fields once reported, so memory does not grow with the
+    // volume of failure messages.
+    const bool release_details = xml_stream && json_output_path.empty() && custom_reporters().empty();
+    // Set once a result is final, so the watchdog can read it concurrently.
+    auto reported = std::make_unique<std::atomic<bool>[]>(results.size());
+    detail::cancel_flag.store(false);
+    detail::cancel_source = std::stop_source();
+    auto finish = [&](std::size_t slot) {
+        if (fail_fast && !results[slot].skipped && !results[slot].passed) request_cancellation();
+        report.test_finished(results[slot]);
+        if (release_details) std::vector<Failure>().swap(results[slot].failures);
+        reported[slot].store(true, std::memory_order_release);
+    };
+
+    report.run_started({runnable.size(), tests.size(), test_jobs, shard_index, total_shards});
+    
+    auto suite_start = std::chrono::high_resolution_clock::now();
+
+    for (std::size_t slot = 0; slot < results.size(); ++slot) {
+        if (results[slot].skipped) finish(slot);
+    }
+
+    // A test that overruns its limit is reported as failed, the reporters
+    // are closed with what has finished so far, and the process exits: the
+    // hung thread cannot be stopped, but CI still gets a complete report.
+    auto limit_of = [](const TestCase& t) { return t.time_limit.count() > 0 ? t.time_limit : test_timeout; };
+#if defined(_WIN32)
+    if (isolate_tests) {
+        std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " --mt_isolate needs fork(); running in-process.\n";
+        isolate_tests = false;
+    }
+    const bool remote = false;
+#else
+    const bool remote = active_coordinator != nullptr;
+#endif
+    // Only tests running in this process need the watchdog, the event loop
+    // and fixture lifetimes; children and agents handle their own.
+    const bool in_process = !isolate_tests && !remote;
+    std::optional<Watchdog> watchdog;
+    if (in_process && std::any_of(runnable.begin(), runnable.end(), [&](std::size_t slot) { return limit_of(*selected[slot]).count() > 0; })) {
+        watchdog.emplace(test_jobs, [&](std::size_t slot, std::chrono::milliseconds limit) {
+            const TestCase& t = *selected[slot];
+            TestResult timed_out;
+            timed_out.name = t.display_name();
+            timed_out.file = t.file;
+            timed_out.line = t.line;
+            timed_out.passed = false;
+            timed_out.duration_ms = static_cast<double>(limit.count());
+            timed_out.failures.push_back({t.file, t.line,
+                "Timed out after " + std::to_string(limit.count()) + " ms; the run was aborted", 1, {}});
+            double elapsed_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - suite_start).count();
+            report.abort_run(timed_out, [&] {
+                std::vector<TestResult> finished;
+                for (std::size_t i = 0; i < results.size(); ++i) {
+                    if (i == slot) finished.push_back(timed_out);
+                    else if (reported[i].load(std::memory_order_acquire)) finished.push_back(results[i]);
+                }
+                return finished;
+            }, elapsed_ms, 1);
+        });
+    }
+    auto release_fixtures = [&](std::size_t slot) {
+        for (auto* f : selected[slot]->fixtures) {
+            if (f->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) f->release();
+        }
+    };
+    auto run_watched = [&](std::size_t slot, unsigned worker) {
+        if (cancellation_requested()) return; // reported as skipped below
+        auto limit = limit_of(*selected[slot]);
+        report.test_started(results[slot]);
+        if (watchdog && limit.count() > 0) watchdog->begin(worker, slot, limit);
+        run_test(*selected[slot], results[slot]);
+        if (watchdog && limit.count() > 0) watchdog->end(worker);
+        finish(slot);
+        release_fixtures(slot);
+    };
+
+    // Benchmarks run afterwards, one at a time on this thread, so their
+    // timings are not disturbed by concurrently running tests.
+    std::vector<std::size_t> benches;
+    std::erase_if(runnable, [&](std::size_t slot) {
+        if (selected[slot]->kind != TestKind::BENCH) return false;
+        benches.push_back(slot);
+        return true;
+    });
+    // Async tests share one event loop on this thread after the pool has
+    // finished. Isolated and remote runs give each its own loop.
+    std::vector<std::size_t> async_tests;
+    if (in_process) {
+        std::erase_if(runnable, [&](std::size_t slot) {
+            if (selected[slot]->kind != TestKind::ASYNC) return false;
+            async_tests.push_back(slot);
+            return true;
+        });
+    }
+
+    if (shuffle_tests) {
+        std::uint32_t seed = iteration_seed(random_seed, iteration);
+        std::cout << "Note: Randomizing tests' orders with a seed of " << seed << " .\n";
+        shuffle_order(runnable, seed);
+    } else if (test_jobs > 1 && !timings.empty()) {
+        std::vector<std::string_view> names;
+        for (std::size_t slot : runnable) names.push_back(results[slot].name);
+        std::vector<std::size_t> ordered;
+        for (std::size_t i : lpt_order(names, timings)) ordered.push_back(runnable[i]);
+        runnable = std::move(ordered);
+    }
+    batch_by_fixture(runnable, selected);
+    batch_by_fixture(benches, selected);
+    batch_by_fixture(async_tests, selected);
+
+    // Each fixture lives until its last declared user in this iteration has
+    // run. Isolated children and agents build their own copies and keep
+    // them until they exit.
+    std::vector<detail::FixtureBase*> fixtures;
+    if (in_process) {
+        for (const auto* order : {&runnable, &async_tests, &benches}) {
+            for (std::size_t slot : *order) {
+                for (auto* f : selected[slot]->fixtures) {
+                    if (std::find(fixtures.begin(), fixtures.end(), f) == fixtures.end()) {
+                        f->pending.store(0, std::memory_order_relaxed);
+                        fixtures.push_back(f);
+                    }
+                    f->pending.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    // Tests traced in this process land on their worker's track. Children
+    // and agents keep their own clocks, so isolated and remote runs trace
+    // each test from dispatch to result on the lowest free lane instead.
+    const bool tracing = detail::tracing();
+    std::vector<detail::TraceClock::time_point> dispatched;
+    std::vector<std::uint32_t> lane_of;
+    std::vector<bool> lane_busy;
+    auto started = [&](std::size_t slot) {
+        report.test_started(results[slot]);
+        if (!tracing) return;
+        dispatched.resize(results.size());
+        lane_of.resize(results.size());
+        auto free = std::find(lane_busy.begin(), lane_busy.end(), false);
+        if (free == lane_busy.end()) {
+            lane_busy.push_back(false);
+            free = lane_busy.end() - 1;
+            detail::name_trace_track(static_cast<std::uint32_t>(lane_busy.size()),
+                (remote ? "agent lane " : "child ") + std::to_string(lane_busy.size() - 1));
+        }
+        *free = true;
+        lane_of[slot] = static_cast<std::uint32_t>(free - lane_busy.begin()) + 1;
+        dispatched[slot] = detail::TraceClock::now();
+    };
+    auto finish_dispatched = [&](std::size_t slot) {
+        if (tracing && slot < lane_of.size() && lane_of[slot] != 0) {
+            detail::record_trace_span(results[slot].name, "test", dispatched[slot], detail::TraceClock::now(),
+                lane_of[slot], trace_args(results[slot]));
+            lane_busy[lane_of[slot] - 1] = false;
+            lane_of[slot] = 0;
+        }
+        finish(slot);
+    };
+    if (tracing && in_process) {
+        for (unsigned w = 0; w < std::max(1u, test_jobs); ++w) detail::name_trace_track(w + 1, "worker " + std::to_string(w));
+    }
+
+    if (remote) {
+#if !defined(_WIN32)
+        // Benchmarks go last, after every agent has drained the tests.
+        std::vector<std::size_t> tasks = runnable;
+        tasks.insert(tasks.end(), benches.begin(), benches.end());
+        auto limit_of_slot = [&](std::size_t slot) { return limit_of(*selected[slot]); };
+        active_coordinator->run(tasks, selected, results, limit_of_slot, started, finish_dispatched);
+#endif
+    } else if (isolate_tests) {
+#if !defined(_WIN32)
+        // Children run one test per command; crashes and timeouts cost a
+        // respawn, not the run. Benchmarks get a pool of one afterwards.
+        auto in_child = [&](std::size_t slot, TestResult& r) { run_test(*selected[slot], r); };
+        auto limit_of_slot = [&](std::size_t slot) { return limit_of(*selected[slot]); };
+        auto workers = static_cast<unsigned>(std::min<std::size_t>(std::max(1u, test_jobs), std::max<std::size_t>(1, runnable.size())));
+        if (!runnable.empty()) IsolatedPool(workers, in_child).run(runnable, results, limit_of_slot, started, finish_dispatched);
+        if (!benches.empty()) IsolatedPool(1, in_child).run(benches, results, limit_of_slot, started, finish_dispatched);
+#endif
+    } else {
+        parallel_for_each(runnable.size(), test_jobs, [&](std::size_t task, unsigned worker) {
+            detail::trace_track = worker + 1;
+            run_watched(runnable[task], worker);
+        });
+        if (!async_tests.empty() && !cancellation_requested()) {
+            std::vector<TestContext> contexts(async_tests.size());
+            std::vector<detail::AsyncRun> runs(async_tests.size());
+            for (std::size_t i = 0; i < runs.size(); ++i) {
+                const TestCase& t = *selected[async_tests[i]];
+                contexts[i].file = t.file;
+                contexts[i].live = &results[async_tests[i]];
+                runs[i].test = &t;
+                runs[i].ctx = &contexts[i];
+                runs[i].limit = limit_of(t);
+                runs[i].metered = instrument_enabled;
+                report.test_started(results[async_tests[i]]);
+            }
+            // The loop gets a track of its own after the workers'.
+            const auto loop_track = std::max(1u, test_jobs) + 1;
+            if (tracing) detail::name_trace_track(loop_track, "event loop");
+            detail::trace_track = loop_track;
+            auto loop_start = detail::TraceClock::now();
+            detail::drive_async(runs, [&](std::size_t i) {
+                std::size_t slot = async_tests[i];
+                results[slot].duration_ms = runs[i].duration_ms;
+                results[slot].resources = runs[i].resources;
+                // Cut short by fail-fast before failing on its own: like a
+                // test that never started.
+                if (runs[i].cancelled && !contexts[i].failed) results[slot].skipped = true;
+                collect_failures(*selected[slot], contexts[i], results[slot]);
+                if (tracing) {
+                    auto end = loop_start + std::chrono::duration_cast<detail::TraceClock::duration>(
+                        std::chrono::duration<double, std::milli>(runs[i].duration_ms));
+                    detail::record_trace_span(results[slot].name, "test", loop_start, end, loop_track,
+                        trace_args(results[slot]));
+                }
+                finish(slot);
+                release_fixtures(slot);
+            });
+        }
+        detail::trace_track = 1;
+        for (std::size_t slot : benches) run_watched(slot, 0);
+        watchdog.reset();
+    }
+
+    // Tests a fail-fast run never started.
+    if (cancellation_requested()) {
+        for (std::size_t slot = 0; slot < results.size(); ++slot) {
+            if (reported[slot].load(std::memory_order_relaxed)) continue;
+            results[slot].skipped = true;
+            finish(slot);
+        }
+    }
+    for (auto* f : fixtures) {
+        if (f->pending.exchange(0, std::memory_order_relaxed) > 0) f->release();
+    }
+
+    auto suite_end = std::chrono::high_resolution_clock::now();
+    double total_ms = std::chrono::duration<double, std::milli>(suite_end - suite_start).count();
+
+    RunSummary summary = summarize(results, total_ms);
+
+    auto& tallies = get_tallies();
+    tallies.resize(tests.size());
+    for (std::size_t slot = 0; slot < results.size(); ++slot) {
+        if (results[slot].skipped) continue;
+        auto& tally = tallies[selected[slot]->index];
+        if (tally.name.empty()) tally.name = results[slot].name;
+        tally.runs++;
+        if (!results[slot].passed) tally.failures++;
+    }
+
+    if (!timings_path.empty()) {
+        for (const auto& r : results) {
+            if (!r.skipped) timings[r.name] = r.duration_ms;
+        }
+        save_timings(timings_path, timings);
+    }
+
+    report.run_finished(summary);
+
+    if (!bench_out_path.empty()) {
+        save_bench_baseline(bench_out_path, results);
+        std::cout << GRAY() << "[   INFO   ] Benchmark baseline written to: " << bench_out_path << RESET() << "\n";
+    }
+
+    return summary.failed;
+}
+
+int run_all_tests(int argc, char* argv[]) {
+    get_tests().expand_cases();
+    parse_environment();
+    if (argc > 0 && argv) {
+        parse_args(argc, argv);
+        if (show_help_only) return 0;
+    }
+    if (perf_counters_enabled) {
+        detail::PerfCounterGroup probe;
+        if (!probe.available()) {
+            std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " Hardware counters unavailable (" << probe.error()
+                      << "); continuing without them.\n";
+            perf_counters_enabled = false;
+        }
+    }
+    if (!agent_address.empty()) return run_agent(agent_address);
+    
+    if (total_shards < 1 || shard_index < 0 || shard_index >= total_shards) {
+        std::cout << RED() << "[  ERROR   ]" << RESET() << " Invalid sharding: GTEST_SHARD_INDEX=" << shard_index
+                  << " must be in [0, GTEST_TOTAL_SHARDS=" << total_shards << ").\n";
+        return 1;
+    }
+    if (!shard_status_file.empty()) {
+        std::ofstream touch(shard_status_file, std::ios::app);
+    }
+
+#if defined(_WIN32)
+    if (!coordinator_address.empty()) {
+        std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " --mt_coordinator needs POSIX sockets; running locally.\n";
+    }
+#else
+    std::optional<Coordinator> coordinator;
+    if (!coordinator_address.empty()) {
+        if (!coordinator.emplace(coordinator_address).listening()) return 1;
+        active_coordinator = &*coordinator;
+    }
+#endif
+
+    if (shuffle_tests && random_seed == 0) {
+        auto now = std::chrono::system_clock::now().time_since_epoch().count();
+        random_seed = static_cast<std::uint32_t>(static_cast<std::uint64_t>(now) % 99999u) + 1;
+    }
+
+    if (!trace_output_path.empty()) detail::start_trace();
+
+    // --mt_until_fail without an explicit --gtest_repeat keeps going.
+    const bool forever = repeat_count < 0 || (until_fail && repeat_count == 1);
+    get_tallies().clear();
+    int iterations = 0;
+    int failed_iterations = 0;
+    for (int iteration = 0; forever || iteration < repeat_count; ++iteration) {
+        if (forever || repeat_count > 1) {
+            std::cout << "\nRepeating all tests (iteration " << iteration + 1 << ") . . .\n\n";
+        }
+        int failed = run_iteration(iteration);
+        iterations++;
+        if (failed > 0) {
+            failed_iterations++;
+            if (until_fail || fail_fast) break;
+        }
+    }
+    if (iterations > 1) print_tallies(iterations);
+    if (!trace_output_path.empty()) {
+        detail::stop_trace();
+        if (write_trace(trace_output_path)) {
+            std::cout << GRAY() << "[   INFO   ] Trace written to: " << trace_output_path << RESET() << "\n";
+        } else {
+            std::cout << YELLOW() << "[ WARNING  ]" << RESET() << " Could not write trace to " << trace_output_path << "\n";
+        }
+    }
+#if !defined(_WIN32)
+    active_coordinator = nullptr;
+#endif
+
+    return failed_iterations > 0 ? 1 : 0;
+}
+
+} // namespace mt
@@ -1,5 +1,10 @@
 #include "ModernTest.hpp"
 
+#include <cmath>
+#include <limits>
+#include <list>
+#include <numeric>
+
 using namespace mt;
 
 TEST("String hashing", [] {
@@ -17,3 +22,105 @@ TEST("Floating math", [] {
     expect(std::abs(value)) < 1.0;
 });
 
+
+TEST("Range equality compares whole buffers", [] {
+    std::vector<std::uint32_t> pixels(1 << 16, 0xff00ff00u);
+    std::vector<std::uint32_t> copy = pixels;
+    expect(pixels).to_equal_range(copy);
+    expect(std::array{1, 2, 3}).to_equal_range(std::vector<int>{1, 2, 3});
+
+    copy[7] = 0;
+    expect(pixels).Not().to_equal_range(copy);
+    expect(std::vector<std::string>{"a", "b"}).Not().to_equal_range(std::vector<std::string>{"a"});
+});
+
+TEST("Range mismatches report the first few indices", [] {
+    std::vector<int> actual(100, 1);
+    std::vector<int> expected(100, 1);
+    for (int i = 0; i < 20; ++i) expected[static_cast<std::size_t>(i * 5)] = 2;
+
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        expect(actual).to_equal_range(expected);
+    }
+    expect(ctx.failures.size()) == 1u;
+    expect(ctx.failures[0].message) ==
+        std::string("20 of 100 element(s) differ; first 8: [0] 1 vs 2, [5] 1 vs 2, [10] 1 vs 2, [15] 1 vs 2, "
+                    "[20] 1 vs 2, [25] 1 vs 2, [30] 1 vs 2, [35] 1 vs 2");
+});
+
+TEST("Approximate range equality uses an absolute epsilon", [] {
+    std::vector<float> vertices(10000);
+    for (std::size_t i = 0; i < vertices.size(); ++i) vertices[i] = static_cast<float>(i) * 0.25f;
+    std::vector<float> nudged = vertices;
+    for (auto& v : nudged) v += 0.0005f;
+
+    expect(vertices).to_be_approx_range(nudged, 0.001);
+    expect(std::vector<double>{1.0, 2.0}).to_be_approx_range(std::array{1, 2}, 1e-9);
+
+    nudged[9000] = std::numeric_limits<float>::quiet_NaN();
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        expect(vertices).to_be_approx_range(nudged, 0.001);
+    }
+    expect(ctx.failures.size()) == 1u;
+    expect(ctx.failures[0].message.starts_with("1 of 10000 element(s) differ; first 1: [9000] 2250 vs nan")) == true;
+});
+
+namespace {
+// Unique object representation, but equality ignores the cached hash.
+struct Tagged {
+    std::uint32_t value;
+    std::uint32_t cached_hash;
+    bool operator==(const Tagged& o) const { return value == o.value; }
+};
+static_assert(std::has_unique_object_representations_v<Tagged>);
+} // namespace
+
+TEST("Class ranges compare with their own operator==", [] {
+    std::vector<Tagged> a{{1, 11}, {2, 22}};
+    std::vector<Tagged> b{{1, 99}, {2, 0}};
+    expect(a).to_equal_range(b);
+
+    b[1].value = 3;
+    expect(a).Not().to_equal_range(b);
+});
+
+TEST("Approximate range equality takes relative and ULP tolerances", [] {
+    std::vector<float> golden{1.0f, 1000.0f, 1e6f, -0.0f};
+    std::vector<float> rendered = golden;
+    for (auto& v : rendered) v = std::nextafter(std::nextafter(v, 2e6f), 2e6f); // two ULPs up
+
+    expect(rendered).to_be_approx_range(golden, {.ulps = 2});
+    expect(rendered).Not().to_be_approx_range(golden, {.ulps = 1});
+    expect(rendered).Not().to_be_approx_range(golden, {.rel = 1e-6}); // nothing is relatively close to zero
+    expect(rendered).Not().to_be_approx_range(golden, 1e-3); // 1e6f is 0.125 apart
+    expect(rendered).to_be_approx_range(golden, {.abs = 1e-3, .rel = 1e-6});
+
+    std::vector<double> inf{std::numeric_limits<double>::infinity(), 0.0};
+    expect(inf).to_be_approx_range(std::vector<double>{std::numeric_limits<double>::infinity(), -0.0}, 0.0);
+    expect(std::vector<double>{std::numeric_limits<double>::quiet_NaN()})
+        .Not().to_be_approx_range(std::vector<double>{std::numeric_limits<double>::quiet_NaN()}, {.ulps = 1000});
+    std::list<int> counts{100, 200};
+    expect(counts).to_be_approx_range(std::vector<int>{101, 198}, {.ulps = 2});
+    expect(counts).Not().to_be_approx_range(std::vector<int>{101, 198}, {.rel = 0.001});
+});
+
+namespace {
+struct Palette {
+    std::vector<std::uint32_t> colors;
+    explicit Palette(std::size_t n) : colors(n) { std::iota(colors.begin(), colors.end(), 0u); }
+    Palette(const Palette&) = delete;
+};
+mt::Fixture<Palette> palette(+[] { return Palette(4096); });
+} // namespace
+
+TEST("Shared fixtures are built on first use", [] {
+    expect(palette->colors.size()) == 4096u;
+}, mt::uses<palette>);
+
+TEST_CASES("Shared fixtures reach every case", std::array{0u, 17u, 4095u}, [](std::uint32_t i) {
+    expect(palette->colors[i]) == i;
+}, mt::uses<palette>);
@@ -0,0 +1,52 @@
+#include "ModernTest.hpp"
+
+#include <thread>
+
+using namespace mt;
+using namespace std::chrono_literals;
+
+namespace {
+mt::task<int> add_later(int a, int b) {
+    co_await mt::sleep_for(1ms);
+    co_return a + b;
+}
+
+mt::task<> fail_later() {
+    co_await mt::yield();
+    throw std::runtime_error("connection reset");
+}
+} // namespace
+
+TEST_ASYNC("Async tests await timers and nested tasks", []() -> mt::task<> {
+    auto start = std::chrono::steady_clock::now();
+    co_await mt::sleep_for(5ms);
+    expect(std::chrono::steady_clock::now() - start >= 5ms) == true;
+    expect(co_await add_later(2, 3)) == 5;
+});
+
+TEST_ASYNC("Async events wake tests from other threads", []() -> mt::task<> {
+    mt::async_event ready;
+    int value = 0;
+    std::thread producer([&] {
+        std::this_thread::sleep_for(2ms);
+        value = 42;
+        ready.set();
+    });
+    co_await ready;
+    producer.join();
+    expect(value) == 42;
+});
+
+TEST_ASYNC("Exceptions propagate through awaited tasks", []() -> mt::task<> {
+    std::string what;
+    try {
+        co_await fail_later();
+    } catch (const std::runtime_error& e) {
+        what = e.what();
+    }
+    expect(what) == std::string("connection reset");
+});
+
+TEST_CASES("Async cases", std::array{1, 2, 3}, [](int n) -> mt::task<> {
+    expect(co_await add_later(n, n)) == 2 * n;
+});
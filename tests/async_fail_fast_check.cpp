@@ -0,0 +1,16 @@
+// A failing async test next to one that waits far longer than ctest
+// allows, run with --mt_fail_fast to check that the event loop stops the
+// waiting body instead of letting it run to its own end.
+#include "ModernTest.hpp"
+
+using namespace mt;
+using namespace std::chrono_literals;
+
+TEST_ASYNC("Fails after a short wait", []() -> mt::task<> {
+    co_await mt::sleep_for(10ms);
+    expect(1 + 1) == 3;
+});
+
+TEST_ASYNC("Waits an hour", []() -> mt::task<> {
+    co_await mt::sleep_for(1h);
+});
@@ -0,0 +1,113 @@
+#include "ModernTestRunner.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace mt;
+
+BENCH("Vector sum", [](BenchState& state) {
+    std::vector<int> v(1024, 1);
+    for (auto _ : state) {
+        int sum = std::accumulate(v.begin(), v.end(), 0);
+        do_not_optimize(sum);
+    }
+    state.set_items_processed(state.iterations() * v.size());
+    state.set_bytes_processed(state.iterations() * v.size() * sizeof(int));
+});
+
+TEST("Bench statistics", [] {
+    BenchResult r;
+    r.samples_ns = {4.0, 1.0, 3.0, 2.0};
+    summarize(r);
+
+    expect(r.min_ns) == 1.0;
+    expect(r.median_ns) == 2.5;
+    expect(r.mean_ns) == 2.5;
+    expect(std::abs(r.stddev_ns - 1.2909944)) < 1e-6;
+});
+
+TEST("Bench loop runs the requested iterations", [] {
+    BenchState state(42);
+    int count = 0;
+    for (auto _ : state) {
+        count++;
+        clobber_memory();
+    }
+    expect(count) == 42;
+    expect(state.looped()) == true;
+});
+
+TEST("Mann-Whitney flags a consistent slowdown", [] {
+    std::vector<double> base = {10.0, 10.2, 9.9, 10.1, 10.0, 9.8};
+    std::vector<double> slower = {12.0, 12.3, 11.9, 12.1, 12.2, 12.4};
+
+    expect(mann_whitney_p_slower(slower, base)) < 0.01;
+    expect(mann_whitney_p_slower(base, slower)) > 0.9;
+    expect(mann_whitney_p_slower(base, base)) > 0.4;
+});
+
+TEST("Regression needs both threshold and significance", [] {
+    BenchResult base, noisy, slower;
+    base.samples_ns = {10.0, 10.2, 9.9, 10.1, 10.0};
+    noisy.samples_ns = {9.0, 14.0, 8.0, 13.0, 11.0};
+    slower.samples_ns = {12.0, 12.3, 11.9, 12.1, 12.2};
+    summarize(base);
+    summarize(noisy);
+    summarize(slower);
+
+    expect(compare_bench(slower, base).regressed) == true;
+    expect(compare_bench(noisy, base).regressed) == false;
+    expect(compare_bench(base, base).regressed) == false;
+});
+
+TEST("Hardware counters degrade to nothing when unavailable", [] {
+    detail::PerfCounterGroup counters;
+    if (!counters.available()) {
+        expect(counters.error().empty()) == false;
+        expect(counters.read().cycles.has_value()) == false;
+        return;
+    }
+    counters.reset();
+    BenchState state(10000);
+    state.count_with(&counters);
+    std::uint64_t sum = 0;
+    for (auto _ : state) {
+        sum += 3;
+        do_not_optimize(sum);
+    }
+    auto read = counters.read();
+    if (read.instructions) expect(*read.instructions) > 10000.0;
+});
+
+TEST("Counters round-trip through baselines", [] {
+    TestResult result;
+    result.name = "Hash lookup";
+    result.bench.emplace();
+    result.bench->iterations = 1000;
+    result.bench->samples_ns = {12.5, 12.75};
+    result.bench->counters = PerfCounters{40.0, 100.0, 0.5, std::nullopt, 0.25};
+
+    auto path = (std::filesystem::temp_directory_path() / "moderntest_counters_baseline.txt").string();
+    expect(save_bench_baseline(path, {result})) == true;
+    auto baseline = load_bench_baseline(path);
+    std::filesystem::remove(path);
+
+    const auto& loaded = baseline.at("Hash lookup");
+    expect(loaded.samples_ns.size()) == 2u;
+    expect(loaded.counters.has_value()) == true;
+    expect(*loaded.counters->ipc()) == 2.5;
+    expect(loaded.counters->llc_misses.has_value()) == false;
+    expect(*loaded.counters->branch_misses) == 0.25;
+    expect(format_counters(*loaded.counters)) ==
+        std::string("40 cycles  100 instructions  IPC 2.5  L1d miss 0.5  branch miss 0.25");
+});
+
+TEST("Version 1 baselines still load", [] {
+    auto path = (std::filesystem::temp_directory_path() / "moderntest_v1_baseline.txt").string();
+    std::ofstream(path) << "# moderntest-bench v1\n100\t5,6,7\tVector sum\n";
+    auto baseline = load_bench_baseline(path);
+    std::filesystem::remove(path);
+
+    expect(baseline.at("Vector sum").median_ns) == 6.0;
+    expect(baseline.at("Vector sum").counters.has_value()) == false;
+});
@@ -0,0 +1,37 @@
+#include "ModernTest.hpp"
+
+#include <numeric>
+#include <thread>
+
+using namespace mt;
+
+TEST("Allocation budgets pass for allocation-free code", [] {
+    std::array<int, 64> scratch{};
+    expect_no_allocations([&] { std::iota(scratch.begin(), scratch.end(), 0); });
+    expect_allocations_at_most(1, [] { do_not_optimize(std::make_unique<int>(7)); });
+});
+
+TEST("Allocation budgets report what was allocated", [] {
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        expect_no_allocations([] { do_not_optimize(std::vector<int>(16)); });
+    }
+    expect(ctx.failures.size()) == 1u;
+    expect(ctx.failures[0].message) == std::string("Expected at most 0 allocation(s), got 1 (64 bytes)");
+});
+
+TEST("Latency budgets check a percentile", [] {
+    int counter = 0;
+    auto bump = [&] { do_not_optimize(++counter); };
+    expect(bump).to_complete_within(std::chrono::milliseconds{50});
+    expect(counter) == 1000;
+
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        auto sleepy = [] { std::this_thread::sleep_for(std::chrono::microseconds{200}); };
+        expect(sleepy).to_complete_within(std::chrono::microseconds{100}, 0.5, 10);
+    }
+    expect(ctx.failed) == true;
+});
@@ -0,0 +1,22 @@
+// A TEST_CASES table that lives in a different translation unit from its
+// TEST_CASES (filter_check.cpp). This file is linked last, so the table's
+// dynamic initializer runs after the registrar's.
+#include "ModernTest.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace mt;
+
+struct SquareCase { int in; int out; };
+extern const std::vector<SquareCase> late_square_cases;
+const std::vector<SquareCase> late_square_cases = {{2, 4}, {5, 25}, {-7, 49}, {10, 100}};
+
+TEST("TEST_CASES reads a table from another translation unit at run time", [] {
+    std::vector<std::string> names;
+    for (const auto& t : get_tests()) {
+        if (t.name == "Late squares") names.push_back(t.display_name());
+    }
+    expect(names.size()) == late_square_cases.size();
+    expect(names.back()) == std::string("Late squares/3");
+});
@@ -0,0 +1,87 @@
+# Compile-time benchmark behind the moderntest_compile_bench target. Each
+# translation unit in SOURCES is compiled RUNS times (the fastest run
+# counts) and preprocessed once (its size tracks what the headers pull in,
+# without timing noise). The numbers go to BASELINE_OUT; given an earlier
+# file in BASELINE, the script fails when a TU compiles more than TOLERANCE
+# percent slower or preprocesses to more than 1% more bytes.
+#
+# COMPILE and PREPROCESS are argument lists for COMPILER with <SOURCE> and
+# <OBJECT> placeholders; lists are passed joined with "|".
+cmake_minimum_required(VERSION 3.23) # string(TIMESTAMP) with %f
+
+foreach(var COMPILE PREPROCESS SOURCES)
+    string(REPLACE "|" ";" ${var} "${${var}}")
+endforeach()
+file(MAKE_DIRECTORY ${OUT_DIR})
+
+set(baseline_entries "")
+if(BASELINE)
+    if(NOT EXISTS "${BASELINE}")
+        message(FATAL_ERROR "Compile baseline ${BASELINE} does not exist")
+    endif()
+    file(STRINGS "${BASELINE}" baseline_entries)
+endif()
+
+set(results "")
+set(regressions "")
+foreach(tu IN LISTS SOURCES)
+    get_filename_component(stem ${tu} NAME_WE)
+    set(source ${SOURCE_DIR}/${tu})
+    string(REPLACE "<SOURCE>" "${source}" compile "${COMPILE}")
+    string(REPLACE "<OBJECT>" "${OUT_DIR}/${stem}.o" compile "${compile}")
+    string(REPLACE "<SOURCE>" "${source}" preprocess "${PREPROCESS}")
+
+    set(best_us "")
+    foreach(run RANGE 1 ${RUNS})
+        string(TIMESTAMP start "%s%f")
+        execute_process(COMMAND ${COMPILER} ${compile} RESULT_VARIABLE status)
+        string(TIMESTAMP end "%s%f")
+        if(NOT status EQUAL 0)
+            message(FATAL_ERROR "${tu} does not compile")
+        endif()
+        math(EXPR us "${end} - ${start}")
+        if(best_us STREQUAL "" OR us LESS best_us)
+            set(best_us ${us})
+        endif()
+    endforeach()
+    math(EXPR ms "${best_us} / 1000")
+
+    execute_process(COMMAND ${COMPILER} ${preprocess} OUTPUT_FILE ${OUT_DIR}/${stem}.ii RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "${tu} does not preprocess")
+    endif()
+    file(SIZE ${OUT_DIR}/${stem}.ii bytes)
+    list(APPEND results "${tu} ${ms} ${bytes}")
+
+    set(line "${tu}: ${ms} ms, ${bytes} bytes preprocessed")
+    foreach(entry IN LISTS baseline_entries)
+        string(REPLACE " " ";" fields "${entry}")
+        list(GET fields 0 base_tu)
+        if(NOT base_tu STREQUAL tu)
+            continue()
+        endif()
+        list(GET fields 1 base_ms)
+        list(GET fields 2 base_bytes)
+        math(EXPR time_pct "(${ms} - ${base_ms}) * 100 / (${base_ms} + 1)")
+        math(EXPR size_pct "(${bytes} - ${base_bytes}) * 100 / (${base_bytes} + 1)")
+        string(APPEND line " (${time_pct}% time, ${size_pct}% size vs baseline)")
+        math(EXPR time_limit "${base_ms} * (100 + ${TOLERANCE}) / 100")
+        math(EXPR size_limit "${base_bytes} * 101 / 100")
+        if(ms GREATER time_limit)
+            list(APPEND regressions "${tu} (time)")
+        endif()
+        if(bytes GREATER size_limit)
+            list(APPEND regressions "${tu} (size)")
+        endif()
+    endforeach()
+    message("${line}")
+endforeach()
+
+list(JOIN results "\n" text)
+file(WRITE ${BASELINE_OUT} "${text}\n")
+message("Baseline written to ${BASELINE_OUT}")
+
+if(regressions)
+    list(JOIN regressions ", " names)
+    message(FATAL_ERROR "Compile cost regressed against ${BASELINE}: ${names}")
+endif()
@@ -0,0 +1,2 @@
+// Baseline: the cost of the header alone.
+#include "ModernTest.hpp"
@@ -0,0 +1,3 @@
+// The runner internals, for comparison: only the runner library and the
+// framework's white-box tests pay for these.
+#include "ModernTestRunner.hpp"
@@ -0,0 +1,59 @@
+// A representative test file: plain assertions, containers, mocks and a
+// case table.
+#include "ModernTest.hpp"
+
+#include <numeric>
+
+using namespace mt;
+
+namespace {
+struct Order {
+    int id;
+    double total;
+};
+
+struct Case {
+    int in;
+    int out;
+};
+const std::vector<Case> doubling = {{0, 0}, {1, 2}, {21, 42}};
+} // namespace
+
+TEST("Arithmetic", [] {
+    expect(1 + 1) == 2;
+    expect(3 * 3).Not() == 10;
+    expect(2.5) > 2.0;
+});
+
+TEST("Strings", [] {
+    std::string s = "moderntest";
+    expect(s.size()) == 10u;
+    expect(s.substr(0, 6)) == std::string("modern");
+});
+
+TEST("Containers", [] {
+    std::vector<int> v = {1, 2, 3};
+    expect(v).to_contain(2);
+    expect(v).Not().is_empty();
+    expect(v).to_equal_range(std::vector<int>{1, 2, 3});
+});
+
+TEST("Mocks", [] {
+    auto save = mt::mock<bool(const Order&)>([](const Order& o) { return o.total > 0; });
+    save(Order{1, 9.5});
+    expect(save).to_have_been_called_times(1);
+});
+
+TEST("Approximate", [] {
+    std::vector<float> a = {0.1f, 0.2f};
+    expect(a).to_be_approx_range(std::vector<float>{0.1f, 0.2f}, 1e-6);
+});
+
+TEST_CASES("Doubling", doubling, [](const Case& c) { expect(c.in * 2) == c.out; });
+
+PROPERTY("Addition commutes", [](int a, int b) { expect(a + b) == b + a; });
+
+BENCH("Accumulate", [](BenchState& state) {
+    std::vector<int> v(256, 1);
+    for (auto _ : state) do_not_optimize(std::accumulate(v.begin(), v.end(), 0));
+});
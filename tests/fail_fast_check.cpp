@@ -0,0 +1,40 @@
+// Run by ctest with --mt_jobs=2 --mt_fail_fast. The first two tests land on
+// different workers: one waits on the cancellation token, the other fails
+// once it knows the first is running. The waiting test must wake up and
+// see the stop, and the four tests queued behind them must never start.
+#include "ModernTestRunner.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace mt;
+using namespace std::chrono_literals;
+
+namespace {
+std::atomic<bool> waiting{false};
+}
+
+TEST("Waits for cancellation", [] {
+    std::mutex m;
+    std::condition_variable_any cv;
+    std::unique_lock lock(m);
+    waiting.store(true);
+    auto token = mt::cancellation_token();
+    cv.wait_for(lock, token, 10s, [] { return false; }); // returns early only on a stop
+    expect(token.stop_requested()) == true;
+    expect(mt::cancellation_requested()) == true;
+});
+
+TEST("Fails while the other runs", [] {
+    for (int i = 0; i < 1000 && !waiting.load(); ++i) std::this_thread::sleep_for(10ms);
+    expect(waiting.load()) == true;
+    expect(1 + 1) == 3;
+});
+
+TEST("Never starts 1", [] { expect(true) == true; });
+TEST("Never starts 2", [] { expect(true) == true; });
+TEST("Never starts 3", [] { expect(true) == true; });
+TEST("Never starts 4", [] { expect(true) == true; });
@@ -0,0 +1,85 @@
+#include "ModernTestRunner.hpp"
+
+using namespace mt;
+
+TEST("Glob search is unanchored and case-insensitive", [] {
+    expect(matches_filter("Vector matcher", "vector")) == true;
+    expect(matches_filter("Vector matcher", "V*r m?tcher")) == true;
+    expect(matches_filter("Vector matcher", "*match*")) == true;
+    expect(matches_filter("Vector matcher", "Vector*z")) == false;
+    expect(matches_filter("aaab", "a*a*b")) == true;
+});
+
+TEST("Filter expressions follow gtest syntax", [] {
+    TestFilter filter("ModernTest.Math*:Vector*-*negated:*works");
+
+    expect(filter.matches("Math rules")) == true;
+    expect(filter.matches("Vector matcher")) == true;
+    expect(filter.matches("Math works")) == false;
+    expect(filter.matches("Vector negated")) == false;
+    expect(filter.matches("String hashing")) == false;
+});
+
+TEST("Negative-only filters keep everything else", [] {
+    TestFilter filter("-Mock*");
+
+    expect(filter.matches("Mocking check")) == false;
+    expect(filter.matches("Math works")) == true;
+    expect(TestFilter("").matches("anything")) == true;
+});
+
+TEST("Case suffixes take part in matching", [] {
+    TestFilter filter("ModernTest.Table/1*:Grid/*-Grid/3");
+
+    expect(filter.matches("Table", "/1")) == true;
+    expect(filter.matches("Table", "/12")) == true;
+    expect(filter.matches("Table", "/2")) == false;
+    expect(filter.matches("Grid", "/0")) == true;
+    expect(filter.matches("Grid", "/3")) == false;
+});
+
+TEST("Exact gtest names select exactly one case", [] {
+    TestFilter filter("ModernTest.Squares/1");
+
+    expect(filter.matches("Squares", "/1")) == true;
+    expect(filter.matches("Squares", "/12")) == false;
+    expect(filter.matches("Squares", "/0")) == false;
+    expect(filter.matches("Big Squares", "/1")) == false;
+    expect(TestFilter("Squares/1").matches("Squares", "/12")) == false;
+    expect(TestFilter("Squares/1").matches("Big Squares", "/1")) == true;
+    expect(TestFilter("ModernTest.Math rules").matches("Math rules extended")) == false;
+});
+
+TEST("Exact gtest names may contain - and :", [] {
+    TestFilter filter("ModernTest.Round-robin: one case-per-shard");
+
+    expect(filter.matches("Round-robin: one case-per-shard")) == true;
+    expect(filter.matches("Round")) == false;
+    expect(filter.matches("one case")) == false;
+    expect(TestFilter("ModernTest.Round*:Grid-*shard").matches("Round-robin: one case-per-shard")) == false;
+});
+
+struct SquareCase { int in; int out; };
+static const std::vector<SquareCase> square_cases = {{0, 0}, {-3, 9}, {12, 144}};
+
+TEST_CASES("Squares", square_cases, [](const SquareCase& c) {
+    expect(c.in * c.in) == c.out;
+});
+
+TEST("TEST_CASES registers one entry per element", [] {
+    std::vector<std::string> names;
+    for (const auto& t : get_tests()) {
+        if (t.name == "Squares") names.push_back(t.display_name());
+    }
+    expect(names.size()) == 3u;
+    expect(names[0]) == std::string("Squares/0");
+    expect(names[2]) == std::string("Squares/2");
+});
+
+// Defined in case_table_check.cpp, which links (and so initializes) after
+// this file: the registrar must not read its size during static init.
+extern const std::vector<SquareCase> late_square_cases;
+
+TEST_CASES("Late squares", late_square_cases, [](const SquareCase& c) {
+    expect(c.in * c.in) == c.out;
+});
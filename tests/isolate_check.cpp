@@ -0,0 +1,18 @@
+// Tests that would take the whole binary down in-process, run by ctest
+// under --mt_isolate to check that each fails alone and the run goes on.
+#include "ModernTest.hpp"
+
+#include <thread>
+
+using namespace mt;
+
+TEST("Aborts", [] { std::abort(); });
+
+TEST("Dereferences null", [] {
+    volatile int* p = nullptr;
+    *p = 1;
+});
+
+TEST("Hangs", [] { std::this_thread::sleep_for(std::chrono::hours{1}); }, mt::timeout{std::chrono::milliseconds{100}});
+
+TEST("Runs after the crashes", [] { expect(2 * 21) == 42; });
@@ -0,0 +1,62 @@
+# Runs TEST_EXE with --mt_output=json:REPORT and checks that the report
+# parses and carries the run totals and the per-test fields.
+#   cmake -DTEST_EXE=<reporter_check> -DREPORT=<file> -P json_report_check.cmake
+file(REMOVE ${REPORT})
+execute_process(COMMAND ${TEST_EXE} --mt_output=json:${REPORT} OUTPUT_QUIET)
+if(NOT EXISTS ${REPORT})
+    message(FATAL_ERROR "${TEST_EXE} wrote no JSON report to ${REPORT}")
+endif()
+file(READ ${REPORT} json)
+
+function(expect_field expected)
+    string(JSON actual ERROR_VARIABLE error GET "${json}" ${ARGN})
+    if(error)
+        message(FATAL_ERROR "${REPORT}: ${error}")
+    endif()
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "${REPORT}: ${ARGN} is '${actual}', expected '${expected}'")
+    endif()
+endfunction()
+
+expect_field(ModernTest name)
+expect_field(3 tests)
+expect_field(1 failures)
+expect_field(1 skipped)
+string(JSON time_type TYPE "${json}" time_ms)
+if(NOT time_type STREQUAL "NUMBER")
+    message(FATAL_ERROR "${REPORT}: time_ms is ${time_type}, expected NUMBER")
+endif()
+
+string(JSON count LENGTH "${json}" testcases)
+if(NOT count EQUAL 3)
+    message(FATAL_ERROR "${REPORT}: ${count} testcases, expected 3")
+endif()
+set(statuses "")
+math(EXPR last "${count} - 1")
+foreach(i RANGE ${last})
+    foreach(key name file line status duration_ms failures)
+        string(JSON unused ERROR_VARIABLE error GET "${json}" testcases ${i} ${key})
+        if(error)
+            message(FATAL_ERROR "${REPORT}: testcase ${i} has no '${key}'")
+        endif()
+    endforeach()
+    string(JSON name GET "${json}" testcases ${i} name)
+    string(JSON status GET "${json}" testcases ${i} status)
+    list(APPEND statuses "${name}=${status}")
+    if(name STREQUAL "Fails twice")
+        string(JSON failures LENGTH "${json}" testcases ${i} failures)
+        if(NOT failures EQUAL 2)
+            message(FATAL_ERROR "${REPORT}: 'Fails twice' has ${failures} failures, expected 2")
+        endif()
+        string(JSON line_type TYPE "${json}" testcases ${i} failures 0 line)
+        if(NOT line_type STREQUAL "NUMBER")
+            message(FATAL_ERROR "${REPORT}: failure line is ${line_type}, expected NUMBER")
+        endif()
+        expect_field("Expected [2] == [3]" testcases ${i} failures 0 message)
+        expect_field("Expected [4] == [5]" testcases ${i} failures 1 message)
+    endif()
+endforeach()
+list(SORT statuses)
+if(NOT statuses STREQUAL "Fails twice=failed;Passes=passed;Skipped=skipped")
+    message(FATAL_ERROR "${REPORT}: unexpected test statuses ${statuses}")
+endif()
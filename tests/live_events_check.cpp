@@ -0,0 +1,17 @@
+// Two interleaved async tests: one fails early and keeps running, the other
+// passes in between. Run by ctest with --mt_output=jsonl to check that the
+// failure event goes out as it is recorded, before the other test ends.
+#include "ModernTest.hpp"
+
+using namespace mt;
+using namespace std::chrono_literals;
+
+TEST_ASYNC("Fails early and finishes late", []() -> mt::task<> {
+    expect(1 + 1) == 3;
+    co_await mt::sleep_for(50ms);
+});
+
+TEST_ASYNC("Passes in between", []() -> mt::task<> {
+    co_await mt::sleep_for(10ms);
+    expect(1 + 1) == 2;
+});
@@ -0,0 +1,120 @@
+#include "ModernTest.hpp"
+
+#include <functional>
+#include <thread>
+
+using namespace mt;
+
+TEST("Mocks record arguments by default", [] {
+    auto greet = mt::mock<std::string(const std::string&)>([](const std::string& n) { return "hi " + n; });
+
+    expect(greet("ada")) == std::string("hi ada");
+    greet("bob");
+
+    expect(greet).to_have_been_called_times(2);
+    expect(greet).to_have_been_called_with("bob");
+    expect(greet).Not().to_have_been_called_with("eve");
+    expect(std::get<0>(greet.calls[0])) == std::string("ada");
+    expect(greet.calls.size()) == 2u;
+
+    greet.calls.clear();
+    expect(greet.calls.empty()) == true;
+    expect(greet).to_have_been_called_times(0);
+});
+
+TEST("Mock call logs stay in order across arena chunks", [] {
+    auto m = mt::mock<void(std::string)>();
+    for (int i = 0; i < 1000; ++i) m(std::to_string(i));
+
+    expect(m.calls.size()) == 1000u;
+    expect(std::get<0>(m.calls.front())) == std::string("0");
+    expect(std::get<0>(m.calls[15])) == std::string("15");
+    expect(std::get<0>(m.calls[16])) == std::string("16");
+    expect(std::get<0>(m.calls.back())) == std::string("999");
+    int expected = 0;
+    for (const auto& call : m.calls) {
+        if (std::get<0>(call) != std::to_string(expected)) break;
+        expected++;
+    }
+    expect(expected) == 1000;
+
+    auto copy = m;
+    expect(copy).to_have_been_called_with("500");
+    expect(std::get<0>(copy.calls[999])) == std::string("999");
+});
+
+TEST("Mock behaviors take any callable and copy with the mock", [] {
+    int offset = 10;
+    auto add = mt::mock<int(int)>([offset](int x) { return x + offset; });
+    auto copy = add;
+    expect(copy(1)) == 11;
+
+    auto empty = mt::mock<int(int)>(std::function<int(int)>{});
+    expect(static_cast<bool>(empty.behavior)) == false;
+    expect(empty(1)) == 0;
+
+    int (*twice)(int) = [](int x) { return 2 * x; };
+    auto by_pointer = mt::mock<int(int)>(twice);
+    expect(by_pointer(4)) == 8;
+    by_pointer.behavior = nullptr;
+    expect(by_pointer(4)) == 0;
+});
+
+TEST("Count-only mocks keep no arguments", [] {
+    auto tick = mt::mock<void(std::vector<int>), record::count_only>();
+    for (int i = 0; i < 1000; ++i) tick(std::vector<int>(64, i));
+
+    expect(tick).to_have_been_called_times(1000);
+    static_assert(!decltype(tick)::keeps_arguments);
+});
+
+TEST("Ring-buffer mocks keep the last N calls", [] {
+    auto m = mt::mock<int(int), record::last<3>>([](int x) { return x; });
+    for (int i = 0; i < 10; ++i) m(i);
+
+    expect(m).to_have_been_called_times(10);
+    expect(m.retained()) == 3u;
+    expect(std::get<0>(m.recent(0))) == 7;
+    expect(m).to_have_been_called_with(9);
+    expect(m).Not().to_have_been_called_with(2);
+});
+
+TEST("Fingerprint mocks match on hashed arguments", [] {
+    auto upload = mt::mock<void(const std::string&, int), record::fingerprint>();
+    upload(std::string(4096, 'x'), 1);
+
+    expect(upload).to_have_been_called_with(std::string(4096, 'x'), 1);
+    expect(upload).Not().to_have_been_called_with(std::string(4096, 'y'), 1);
+});
+
+TEST("Predicate projections record one flag per call", [] {
+    struct is_negative {
+        bool operator()(int x) const { return x < 0; }
+    };
+    auto m = mt::mock<void(int), record::project<is_negative>>();
+    m(5);
+    m(-2);
+
+    expect(m.recorded().size()) == 2u;
+    expect(m.recorded()[1]) == true;
+});
+
+TEST("Concurrent mocks count and record across threads", [] {
+    auto on_task = mt::concurrent_mock<int(int)>([](int x) { return x + 1; });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 8; ++t) {
+        workers.emplace_back([&on_task, t] {
+            for (int i = 0; i < 10000; ++i) on_task(t * 10000 + i);
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    expect(on_task).to_have_been_called_times(80000);
+    expect(on_task).to_have_been_called_with(79999);
+    expect(on_task).Not().to_have_been_called_with(80000);
+
+    std::size_t logged = 0;
+    on_task.for_each_thread([&](const auto& recorder) { logged += recorder.call_count(); });
+    expect(logged) == 80000u;
+});
@@ -0,0 +1,176 @@
+// The framework's own overhead, measured on synthetic suites of
+// synthetic_tests entries. Run through the moderntest_overhead_bench target,
+// which records a baseline and compares against the previous one; a plain
+// ctest run only smoke-tests each BENCH once.
+#include "ModernTestRunner.hpp"
+
+#include <deque>
+#include <filesystem>
+#include <streambuf>
+
+using namespace mt;
+
+namespace {
+#if defined(MODERNTEST_OVERHEAD_TESTS)
+constexpr std::size_t synthetic_tests = MODERNTEST_OVERHEAD_TESTS;
+#else
+constexpr std::size_t synthetic_tests = 100000;
+#endif
+
+void empty_body() {}
+
+// "Net/Socket/Reconnect 17"-style names spread over a few hundred suites, so
+// patterns have prefixes to reject on.
+const std::vector<std::string>& synthetic_names() {
+    static const std::vector<std::string> names = [] {
+        static constexpr std::string_view areas[] = {"Net", "Render", "Audio", "Physics", "Storage"};
+        std::vector<std::string> out;
+        out.reserve(synthetic_tests);
+        for (std::size_t i = 0; i < synthetic_tests; ++i) {
+            out.push_back(std::string(areas[i % std::size(areas)]) + "/Suite" + std::to_string(i % 397) + "/Case " +
+                          std::to_string(i));
+        }
+        return out;
+    }();
+    return names;
+}
+
+// Swaps in an empty registry for the duration of a benchmark, so the
+// synthetic suite neither runs nor disturbs the real one.
+class ScratchRegistry {
+public:
+    ScratchRegistry() : saved_(detail::registry) { detail::registry = TestRegistry{}; }
+    ~ScratchRegistry() { detail::registry = saved_; }
+    ScratchRegistry(const ScratchRegistry&) = delete;
+    ScratchRegistry& operator=(const ScratchRegistry&) = delete;
+
+private:
+    TestRegistry saved_;
+};
+
+using SyntheticTest = Registrar<void (*)()>;
+
+void register_suite(std::deque<SyntheticTest>& suite) {
+    for (const auto& name : synthetic_names()) {
+        suite.emplace_back(TestStatus::NORMAL, std::source_location::current(), name, &empty_body);
+    }
+}
+
+class DiscardBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+} // namespace
+
+BENCH("Overhead: register synthetic TESTs", [](BenchState& state) {
+    for (auto _ : state) {
+        ScratchRegistry scratch;
+        std::deque<SyntheticTest> suite;
+        register_suite(suite);
+        do_not_optimize(get_tests().size());
+        state.pause_timing();
+        suite.clear(); // teardown is not registration
+        state.resume_timing();
+    }
+    state.set_items_processed(state.iterations() * synthetic_tests);
+});
+
+BENCH("Overhead: --gtest_list_tests", [](BenchState& state) {
+    ScratchRegistry scratch;
+    std::deque<SyntheticTest> suite;
+    register_suite(suite);
+    DiscardBuffer discard;
+    auto* previous = std::cout.rdbuf(&discard);
+    char program[] = "overhead_bench";
+    char flag[] = "--gtest_list_tests";
+    char* argv[] = {program, flag};
+    for (auto _ : state) parse_args(2, argv);
+    std::cout.rdbuf(previous);
+    show_help_only = false;
+    state.set_items_processed(state.iterations() * synthetic_tests);
+});
+
+BENCH("Overhead: filter matching", [](BenchState& state) {
+    const auto& names = synthetic_names();
+    const std::string pattern = "Net/*:Render/Suite1?3/*:*Case ?7*:Storage/*/Case *0-*Suite3*:*/Case 99*";
+    std::size_t matched = 0;
+    for (auto _ : state) {
+        TestFilter filter(pattern);
+        for (const auto& name : names) matched += filter.matches(name);
+    }
+    do_not_optimize(matched);
+    state.set_items_processed(state.iterations() * names.size());
+});
+
+BENCH("Overhead: passing assertions", [](BenchState& state) {
+    TestContext ctx;
+    ContextScope scope(ctx);
+    std::vector<int> values = {1, 2, 3};
+    int x = 42;
+    for (auto _ : state) {
+        do_not_optimize(x);
+        expect(x) == 42;
+        expect(x) > 41;
+        expect(values).to_contain(2);
+    }
+    state.set_items_processed(state.iterations() * 3);
+});
+
+BENCH("Overhead: failing assertions", [](BenchState& state) {
+    TestContext ctx;
+    ContextScope scope(ctx);
+    int x = 42;
+    for (auto _ : state) {
+        do_not_optimize(x);
+        expect(x) == 43; // folded into one failure per location after the first
+    }
+    state.set_items_processed(state.iterations());
+});
+
+BENCH("Overhead: mock calls", [](BenchState& state) {
+    auto behavior = [](int v) { return v + 1; };
+    std::optional<Mock<int(int)>> record;
+    record.emplace(behavior);
+    int v = 0;
+    for (auto _ : state) {
+        v = (*record)(v) & 0xffff;
+        if (record->call_count() == 1 << 16) {
+            state.pause_timing(); // keeps the arena from growing without bound
+            record.emplace(behavior);
+            state.resume_timing();
+        }
+    }
+    do_not_optimize(v);
+    state.set_items_processed(state.iterations());
+});
+
+BENCH("Overhead: count-only mock calls", [](BenchState& state) {
+    auto tick = mt::mock<int(int), record::count_only>([](int v) { return v + 1; });
+    int v = 0;
+    for (auto _ : state) {
+        v = tick(v) & 0xffff;
+    }
+    do_not_optimize(v);
+    state.set_items_processed(state.iterations());
+});
+
+BENCH("Overhead: write_junit_xml", [](BenchState& state) {
+    std::vector<TestResult> results(synthetic_tests);
+    const auto& names = synthetic_names();
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        results[i].name = names[i];
+        results[i].file = "tests/synthetic_check.cpp";
+        results[i].line = static_cast<int>(i % 5000) + 1;
+        results[i].duration_ms = 0.25;
+        if (i % 100 == 0) {
+            results[i].passed = false;
+            results[i].failures.push_back({results[i].file, results[i].line, "Expected 42 == 43 <&>", 1, {}});
+        }
+    }
+    auto path = (std::filesystem::temp_directory_path() / "moderntest_overhead_junit.xml").string();
+    for (auto _ : state) write_junit_xml(path, results, 1234.5);
+    state.set_bytes_processed(state.iterations() * static_cast<std::uint64_t>(std::filesystem::file_size(path)));
+    state.set_items_processed(state.iterations() * results.size());
+    std::filesystem::remove(path);
+});
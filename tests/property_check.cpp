@@ -0,0 +1,38 @@
+#include "ModernTest.hpp"
+
+using namespace mt;
+
+PROPERTY("Reversing twice is the identity", [](std::vector<int> v) {
+    auto twice = v;
+    std::reverse(twice.begin(), twice.end());
+    std::reverse(twice.begin(), twice.end());
+    expect(twice == v) == true;
+});
+
+PROPERTY("Concatenation adds lengths", [](const std::string& a, const std::string& b) {
+    return (a + b).size() == a.size() + b.size();
+}, mt::cases{500});
+
+TEST("Failing properties shrink to a minimal counterexample", [] {
+    Property bounded([](int a, const std::string& s) { expect(a < 50 || s.empty()) == true; }, mt::cases{1000});
+    TestCase node;
+    bounded.configure(node);
+
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        bounded();
+    }
+    expect(ctx.failures.size()) == 1u;
+    const auto& message = ctx.failures[0].message;
+    expect(message.find("counterexample: (50, \"a\")") != std::string::npos) == true;
+    expect(message.find("--mt_property_seed=") != std::string::npos) == true;
+});
+
+TEST("Property inputs replay from the same seed", [] {
+    using Args = std::tuple<int, std::string, std::vector<bool>>;
+    auto first = detail::generate_args<Args>(42, 17, 100);
+    auto again = detail::generate_args<Args>(42, 17, 100);
+    expect(first == again) == true;
+    expect(detail::generate_args<Args>(43, 17, 100) == first) == false;
+});
@@ -0,0 +1,72 @@
+// A small suite with its own main: a custom reporter records every event it
+// receives and main checks the sequence after the run. ctest also runs it
+// with --mt_reporter=quiet and with --mt_output=json:FILE (checked by
+// json_report_check.cmake).
+#include "ModernTestRunner.hpp"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mt;
+
+TEST("Passes", [] { expect(1 + 1) == 2; });
+
+TEST("Fails twice", [] {
+    expect(1 + 1) == 3;
+    expect(2 + 2) == 5;
+});
+
+TEST_SKIP("Skipped", [] {});
+
+namespace {
+
+class EventLog : public Reporter {
+public:
+    explicit EventLog(std::vector<std::string>& events) : events_(events) {}
+
+    void run_started(const RunInfo& info) override {
+        events_.push_back("run_started " + std::to_string(info.to_run));
+    }
+    void test_started(const TestResult& r) override { events_.push_back("test_started " + r.name); }
+    void failure_recorded(const TestResult& r, const Failure& f) override {
+        events_.push_back("failure_recorded " + r.name + ": " + f.message);
+    }
+    void test_finished(const TestResult& r) override {
+        events_.push_back("test_finished " + r.name + (r.skipped ? " skipped" : r.passed ? " passed" : " failed"));
+    }
+    void run_finished(const RunSummary& s) override {
+        events_.push_back("run_finished " + std::to_string(s.results.size()));
+    }
+
+private:
+    std::vector<std::string>& events_;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> events;
+    mt::add_reporter(std::make_unique<EventLog>(events));
+    int rc = mt::run_all_tests(argc, argv);
+
+    const std::vector<std::string> expected = {
+        "run_started 2",
+        "test_finished Skipped skipped",
+        "test_started Passes",
+        "test_finished Passes passed",
+        "test_started Fails twice",
+        "failure_recorded Fails twice: Expected [2] == [3]",
+        "failure_recorded Fails twice: Expected [4] == [5]",
+        "test_finished Fails twice failed",
+        "run_finished 3",
+    };
+    if (events != expected) {
+        std::cout << "[ REPORTER ] Unexpected event sequence:\n";
+        for (const auto& e : events) std::cout << "  " << e << "\n";
+        return 2;
+    }
+    std::cout << "[ REPORTER ] Events arrived in order\n";
+    return rc == 1 ? 0 : 2;
+}
@@ -0,0 +1,324 @@
+#include "ModernTestRunner.hpp"
+
+#include <filesystem>
+
+using namespace mt;
+
+TEST("Work-stealing pool visits every index once", [] {
+    std::vector<std::atomic<int>> hits(1000);
+    parallel_for_each(hits.size(), 4, [&](std::size_t i, unsigned) { hits[i]++; });
+
+    int total = 0;
+    for (auto& h : hits) {
+        expect(h.load()) == 1;
+        total += h.load();
+    }
+    expect(total) == 1000;
+});
+
+TEST("Failures stay in the context bound to their thread", [] {
+    TestContext ctx;
+    std::thread worker([&] {
+        ContextScope scope(ctx);
+        expect(1) == 2;
+    });
+    worker.join();
+
+    expect(ctx.failed) == true;
+    expect(ctx.failures.size()) == 1u;
+    expect(current_test().failed) == false;
+});
+
+TEST("Round-robin sharding matches GoogleTest", [] {
+    auto shard1 = assign_shard(7, 3, 1, ShardBalance::ROUND_ROBIN, {});
+    std::vector<bool> expected = {false, true, false, false, true, false, false};
+    expect(shard1 == expected) == true;
+});
+
+TEST("Duration balancing splits one slow test from the rest", [] {
+    std::vector<double> cost = {1, 1, 100, 1, 1, 1};
+    auto shard0 = assign_shard(cost.size(), 2, 0, ShardBalance::DURATION, cost);
+    auto shard1 = assign_shard(cost.size(), 2, 1, ShardBalance::DURATION, cost);
+
+    std::vector<bool> only_slow = {false, false, true, false, false, false};
+    expect(shard0 == only_slow) == true;
+    for (std::size_t i = 0; i < cost.size(); ++i) {
+        expect(shard0[i]).Not() == shard1[i];
+    }
+});
+
+TEST("Registry links nodes in registration order", [] {
+    TestRegistry registry;
+    TestCase a, b, c;
+    a.name = "a";
+    b.name = "b";
+    c.name = "c";
+    registry.add(a);
+    registry.add(b);
+    registry.add(c);
+
+    std::string order;
+    for (const auto& t : registry) order += t.name;
+    expect(order) == std::string("abc");
+    expect(registry.size()) == 3u;
+    expect(c.index) == 2u;
+});
+
+TEST("Resource probe counts allocations on this thread", [] {
+    expect(alloc_hooks_installed()) == true;
+
+    ResourceProbe probe;
+    auto owned = std::make_unique<std::array<char, 4096>>();
+    do_not_optimize(owned);
+    auto usage = probe.finish();
+
+    expect(usage.allocations) == 1u;
+    expect(usage.allocated_bytes >= 4096u) == true;
+});
+
+TEST("Watchdog reports the overrunning slot", [] {
+    std::atomic<std::size_t> timed_out{0};
+    {
+        Watchdog watchdog(2, [&](std::size_t slot, std::chrono::milliseconds) { timed_out = slot; });
+        watchdog.begin(0, 3, std::chrono::milliseconds{1000});
+        watchdog.begin(1, 7, std::chrono::milliseconds{1});
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        watchdog.end(1);
+        watchdog.end(0);
+    }
+    expect(timed_out.load()) == 7u;
+}, mt::timeout{std::chrono::seconds{5}});
+
+TEST("Longest-first order puts unknown tests ahead of slow ones", [] {
+    TimingMap timings = {{"fast", 1.0}, {"slow", 90.0}, {"medium", 10.0}};
+    std::vector<std::string_view> names = {"fast", "slow", "new", "medium"};
+
+    std::vector<std::size_t> expected = {2, 1, 3, 0};
+    expect(lpt_order(names, timings) == expected) == true;
+});
+
+TEST("Timing cache writes leave no temp files behind", [] {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("moderntest_timings_" + std::to_string(std::random_device{}()));
+    fs::create_directories(dir);
+    std::string path = (dir / "timings").string();
+
+    expect(save_timings(path, {{"slow", 90.0}, {"fast", 1.5}})) == true;
+    expect(save_timings(path, {{"slow", 80.0}})) == true;
+    expect(load_timings(path).at("slow")) == 80.0;
+    expect(save_timings((dir / "missing" / "timings").string(), {{"slow", 1.0}})) == false;
+
+    std::size_t files = 0;
+    for ([[maybe_unused]] const auto& entry : fs::directory_iterator(dir)) files++;
+    expect(files) == 1u;
+    fs::remove_all(dir);
+});
+
+TEST("Isolated results survive the wire format", [] {
+    TestResult sent;
+    sent.passed = false;
+    sent.duration_ms = 12.5;
+    sent.failures.push_back({"a.cpp", 7, "Expected [1] == [2]", 1, {}});
+    sent.resources = ResourceUsage{1.0, 2.0, 3, 4, 5, std::nullopt};
+
+    std::string frame = detail::encode_result(42, sent);
+    std::uint64_t slot = 0;
+    TestResult received;
+    expect(detail::decode_result(std::string_view(frame).substr(4), slot, received)) == true;
+    expect(slot) == 42u;
+    expect(received.passed) == false;
+    expect(received.duration_ms) == 12.5;
+    expect(received.failures[0].message) == std::string("Expected [1] == [2]");
+    expect(received.resources->allocated_bytes) == 4u;
+    expect(received.bench.has_value()) == false;
+});
+
+TEST("Shuffled order is a reproducible permutation", [] {
+    std::vector<std::size_t> a(50), b(50);
+    std::iota(a.begin(), a.end(), std::size_t{0});
+    b = a;
+    shuffle_order(a, 1234);
+    shuffle_order(b, 1234);
+
+    expect(a == b) == true;
+    expect(std::is_permutation(a.begin(), a.end(), b.begin())) == true;
+    expect(std::is_sorted(a.begin(), a.end())) == false;
+    expect(iteration_seed(99999, 1)) == 1u;
+});
+
+TEST("Stress mode runs the body on every thread and tags failures", [] {
+    static std::atomic<int> calls{0};
+    calls = 0;
+    auto body = [] {
+        if (calls.fetch_add(1) == 0) expect(1) == 2;
+    };
+    TestCase node;
+    node.name = "stressed";
+    node.target = &body;
+    node.invoke = [](void* target, std::size_t) { (*static_cast<decltype(body)*>(target))(); };
+
+    TestContext ctx;
+    TestResult result;
+    unsigned saved = stress_threads;
+    stress_threads = 4;
+    detail::run_stressed(node, ctx, result);
+    stress_threads = saved;
+
+    expect(calls.load()) == 4;
+    expect(ctx.failed) == true;
+    expect(ctx.failures.size()) == 1u;
+    expect(ctx.failures[0].message.starts_with("[stress thread ")) == true;
+});
+
+TEST("Repeated failures fold into one entry per location", [] {
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        for (int i = 0; i < 1000; ++i) {
+            expect(i) == -1;
+            if (i < 2) expect(i) > 5;
+        }
+    }
+    expect(ctx.failures.size()) == 2u;
+    expect(ctx.failures[0].message) == std::string("Expected [0] == [-1]");
+    expect(ctx.failures[1].message) == std::string("Expected [0] > [5]");
+    expect(ctx.failures[0].hits) == 98u;
+    expect(ctx.failures[0].recent.back()) == std::string("Expected [97] == [-1]");
+    expect(ctx.failures[0].recent.size()) == recent_failure_messages;
+    expect(ctx.failures[1].hits) == 2u;
+    expect(ctx.recorded) == max_failures_per_test;
+    expect(ctx.suppressed) == 902u;
+});
+
+TEST("Distinct assertions with the same shape never fold", [] {
+    TestContext ctx;
+    {
+        ContextScope scope(ctx);
+        expect(1) == 2;
+        expect(3) == 4;
+        for (int i = 0; i < 5; ++i) expect(i) == 99;
+    }
+    expect(ctx.failures.size()) == 3u;
+    expect(ctx.failures[0].message) == std::string("Expected [1] == [2]");
+    expect(ctx.failures[1].message) == std::string("Expected [3] == [4]");
+    expect(ctx.failures[0].hits) == 1u;
+    expect(ctx.failures[1].hits) == 1u;
+    expect(ctx.failures[2].hits) == 5u;
+    expect(ctx.failures[2].recent.back()) == std::string("Expected [4] == [99]");
+});
+
+namespace {
+int lookups_built = 0;
+mt::Fixture lookup([] {
+    ++lookups_built;
+    return std::vector<int>{1, 2, 3};
+});
+mt::Fixture broken([]() -> int { throw std::runtime_error("no database"); });
+} // namespace
+
+TEST("Fixtures build once, share the value and rebuild after release", [] {
+    lookup.release();
+    lookups_built = 0;
+    const auto* first = &lookup.get();
+    expect(lookup->size()) == 3u;
+    expect(&*lookup == first) == true;
+    expect(lookups_built) == 1;
+
+    lookup.release();
+    expect(lookup.ready()) == false;
+    expect((*lookup)[2]) == 3;
+    expect(lookups_built) == 2;
+
+    int thrown = 0;
+    for (int i = 0; i < 2; ++i) {
+        try {
+            broken.get();
+        } catch (const std::runtime_error&) {
+            thrown++;
+        }
+    }
+    expect(thrown) == 2;
+});
+
+TEST("Fixture users are batched at the first of them", [] {
+    TestCase plain, a1, b1, a2, b2;
+    a1.fixtures = a2.fixtures = uses_t<lookup>::list;
+    b1.fixtures = b2.fixtures = uses_t<broken, lookup>::list;
+    std::vector<const TestCase*> tests = {&plain, &a1, &b1, &a2, &plain, &b2};
+    std::vector<std::size_t> order = {0, 1, 2, 3, 4, 5};
+    batch_by_fixture(order, tests);
+    std::vector<std::size_t> expected = {0, 1, 3, 2, 5, 4};
+    expect(order == expected) == true;
+});
+
+namespace {
+mt::task<> nap(std::chrono::milliseconds d) { co_await mt::sleep_for(d); }
+} // namespace
+
+TEST("Event loop overlaps waits and cuts off overrunning bodies", [] {
+    TestCase short_nap, long_nap;
+    short_nap.invoke_async = [](void*, std::size_t) { return nap(std::chrono::milliseconds{30}); };
+    long_nap.invoke_async = [](void*, std::size_t) { return nap(std::chrono::seconds{10}); };
+
+    std::vector<TestContext> contexts(3);
+    std::vector<detail::AsyncRun> runs(3);
+    const TestCase* bodies[] = {&short_nap, &short_nap, &long_nap};
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        runs[i].test = bodies[i];
+        runs[i].ctx = &contexts[i];
+    }
+    runs[2].limit = std::chrono::milliseconds{40};
+
+    std::vector<std::size_t> finished;
+    auto start = std::chrono::steady_clock::now();
+    detail::drive_async(runs, [&](std::size_t i) { finished.push_back(i); });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    expect(elapsed < std::chrono::seconds{5}) == true;
+    expect(finished.size()) == 3u;
+    expect(finished.back()) == 2u;
+    expect(contexts[0].failed) == false;
+    expect(contexts[1].failed) == false;
+    expect(contexts[2].failed) == true;
+    expect(contexts[2].failures[0].message) == std::string("Timed out after 40 ms");
+    expect(runs[1].duration_ms < 60.0) == true; // not 30 + 30
+});
+
+TEST("Agent addresses and registry fingerprints", [] {
+    std::string host, port;
+    expect(detail::split_host_port("build-07:4100", host, port)) == true;
+    expect(host) == std::string("build-07");
+    expect(port) == std::string("4100");
+    expect(detail::split_host_port("[::1]:80", host, port)) == true;
+    expect(host) == std::string("::1");
+    expect(detail::split_host_port(":4100", host, port)) == true;
+    expect(host.empty()) == true;
+    expect(detail::split_host_port("build-07", host, port)) == false;
+    expect(detail::split_host_port("build-07:http", host, port)) == false;
+
+    TestCase a, b;
+    a.name = "Parses";
+    b.name = "Parses";
+    b.case_number = 0;
+    TestRegistry one, other;
+    one.add(a);
+    other.add(b);
+    expect(detail::registry_fingerprint(one) != detail::registry_fingerprint(other)) == true;
+});
+
+TEST("Trace export names tracks and nests spans", [] {
+    std::vector<TraceEvent> events(3);
+    events[0] = {"Parses \"quoted\" input", "test", "\"passed\": false", 10.0, 250.5, 1, false};
+    events[1] = {"decode", "user", "", 20.0, 5.25, 1, false};
+    events[2] = {"queue depth", "counter", "", 30.0, 3.0, 0, true};
+    std::string json = format_trace(events, {{1, "worker 0"}});
+
+    expect(json.find("\"tid\": 1, \"args\": {\"name\": \"worker 0\"}") != std::string::npos) == true;
+    expect(json.find("{\"name\": \"Parses \\\"quoted\\\" input\", \"cat\": \"test\", \"ph\": \"X\", \"pid\": 1, "
+                     "\"tid\": 1, \"ts\": 10.000, \"dur\": 250.500, \"args\": {\"passed\": false}}") != std::string::npos) == true;
+    expect(json.find("\"ph\": \"C\", \"pid\": 1, \"ts\": 30.000, \"args\": {\"value\": 3}}") != std::string::npos) == true;
+
+    // Recorded when the run itself is traced, a no-op otherwise.
+    mt::trace_scope span("format check");
+    mt::trace_counter("events formatted", static_cast<double>(events.size()));
+});
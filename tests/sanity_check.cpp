@@ -22,4 +22,13 @@ TEST("Mocking check", [] {
 
     // Verify
     expect(m).to_have_been_called_times(1);
-});
\ No newline at end of file
+});
+
+TEST("Expectations inspect lvalues in place", [] {
+    std::vector<int> v = {1, 2, 3};
+    auto e = expect(v);
+    static_assert(std::is_same_v<decltype(e), Expectation<std::vector<int>&>>);
+    expect(&e.val) == &v;
+
+    static_assert(std::is_same_v<decltype(expect(std::vector<int>{})), Expectation<std::vector<int>>>);
+});
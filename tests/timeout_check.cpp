@@ -0,0 +1,16 @@
+// A deliberately hanging test, run by ctest to check that --mt_timeout
+// ends the run with a report instead of blocking forever.
+#include "ModernTest.hpp"
+
+#include <mutex>
+#include <thread>
+
+using namespace mt;
+
+TEST("Finishes in time", [] { expect(1 + 1) == 2; });
+
+TEST("Deadlocks", [] {
+    std::mutex m;
+    m.lock();
+    std::this_thread::sleep_for(std::chrono::hours{1});
+}, mt::timeout{std::chrono::milliseconds{100}});
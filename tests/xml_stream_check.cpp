@@ -0,0 +1,69 @@
+// Four tests that finish, then one that kills the process. ctest runs the
+// first five with --mt_xml_stream, then runs "Partial report" on its own to
+// check that the XML left behind is a complete document holding exactly
+// the tests that finished.
+#include "ModernTest.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace mt;
+
+TEST("Streamed first", [] { expect(1 + 1) == 2; });
+TEST("Streamed second", [] { expect(2 + 2) == 4; });
+TEST("Streamed failure <&>", [] { expect(1 + 1) == 3; });
+TEST("Streamed third", [] { expect(3 + 3) == 6; });
+
+// No destructors, no stdio flush: as close to a kill as the test can get.
+TEST("Killed mid-run", [] { std::_Exit(3); });
+
+namespace {
+
+// Checks that every tag is closed in order and that no markup characters
+// appear outside tags. Returns the names of the <testcase> elements.
+std::vector<std::string> parse_testcases(const std::string& xml, bool& well_formed) {
+    std::vector<std::string> open, cases;
+    well_formed = false;
+    std::size_t pos = 0;
+    while ((pos = xml.find('<', pos)) != std::string::npos) {
+        std::size_t end = xml.find('>', pos);
+        if (end == std::string::npos) return cases;
+        std::string tag = xml.substr(pos + 1, end - pos - 1);
+        std::size_t next = xml.find('<', end);
+        if (xml.find('>', end + 1) < next) return cases;
+        pos = end + 1;
+        if (tag.starts_with('?')) continue;
+        if (tag.starts_with('/')) {
+            if (open.empty() || open.back() != tag.substr(1)) return cases;
+            open.pop_back();
+            continue;
+        }
+        bool self_closing = tag.ends_with('/');
+        std::string name = tag.substr(0, tag.find_first_of(" /"));
+        if (name == "testcase") {
+            std::size_t q = tag.find("name=\"") + 6;
+            cases.push_back(tag.substr(q, tag.find('"', q) - q));
+        }
+        if (!self_closing) open.push_back(name);
+    }
+    well_formed = open.empty();
+    return cases;
+}
+
+} // namespace
+
+TEST("Partial report is well-formed", [] {
+    std::ifstream in("xml_stream_partial.xml");
+    expect(static_cast<bool>(in)) == true;
+    std::string xml{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    bool well_formed = false;
+    auto cases = parse_testcases(xml, well_formed);
+    expect(well_formed) == true;
+    expect(cases).to_equal_range(std::vector<std::string>{
+        "Streamed first", "Streamed second", "Streamed failure &lt;&amp;&gt;", "Streamed third"});
+    expect(xml.find("<testsuites tests=\"4\" failures=\"1\" skipped=\"0\"") != std::string::npos) == true;
+});